@@ -3,9 +3,45 @@
 #include <vector>
 #include <memory>
 #include <fstream>
+#include <sstream>
 #include <algorithm>
 #include <stdexcept>
 #include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <cerrno>
+#include <charconv>
+#include <string_view>
+#include <array>
+#include <malloc.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
 
 // Исключение для ошибок доступа
 class AccessDeniedException : public std::runtime_error {
@@ -19,12 +55,199 @@ public:
     InvalidInputException(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+// Результат проверки доступа без исключений
+enum class AccessDecision {
+    Allowed,
+    Denied,
+    UnknownUser,
+    UnknownResource
+};
+
+// Стабильные числовые теги типов пользователей (используются в бинарном снимке)
+enum class UserKind : uint8_t {
+    Student = 1,
+    Teacher = 2,
+    Administrator = 3
+};
+
+// Пул повторяющихся атрибутов (группы, кафедры, должности). Каждая различная
+// строка хранится один раз и получает номер; номер 0 - пустая строка.
+// Строки не удаляются до завершения программы, поэтому ссылки на них
+// действительны всегда, а get() работает без блокировок.
+class AttributePool {
+private:
+    static constexpr size_t chunkBits = 12;
+    static constexpr size_t chunkSize = size_t(1) << chunkBits;
+    static constexpr size_t maxChunks = 4096; // до 16 млн различных строк
+
+    std::atomic<std::string*> chunks[maxChunks] = {};
+    std::unordered_map<std::string_view, uint32_t> ids; // ключи ссылаются на строки в chunks
+    uint32_t count = 0;
+    size_t textBytes = 0;
+    mutable std::shared_mutex mutex;
+
+    AttributePool() { intern(std::string()); }
+
+public:
+    AttributePool(const AttributePool&) = delete;
+    AttributePool& operator=(const AttributePool&) = delete;
+
+    ~AttributePool() {
+        for (auto& chunk : chunks) delete[] chunk.load();
+    }
+
+    static AttributePool& instance() {
+        static AttributePool pool;
+        return pool;
+    }
+
+    uint32_t intern(const std::string& value) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = ids.find(value);
+            if (it != ids.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(value);
+        if (it != ids.end()) return it->second;
+        if (count == chunkSize * maxChunks) throw std::runtime_error("Пул атрибутов переполнен");
+        std::string* chunk = chunks[count >> chunkBits].load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new std::string[chunkSize];
+            chunks[count >> chunkBits].store(chunk, std::memory_order_release);
+        }
+        std::string& stored = chunk[count & (chunkSize - 1)];
+        stored = value;
+        ids.emplace(stored, count);
+        textBytes += value.size() > 15 ? value.capacity() + 1 : 0;
+        return count++;
+    }
+
+    // Номер уже добавленной строки; false, если такой строки в пуле нет
+    bool find(const std::string& value, uint32_t& id) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(value);
+        if (it == ids.end()) return false;
+        id = it->second;
+        return true;
+    }
+
+    const std::string& get(uint32_t id) const {
+        return chunks[id >> chunkBits].load(std::memory_order_acquire)[id & (chunkSize - 1)];
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return count;
+    }
+
+    // Примерный объем памяти пула: строки, их буферы в куче и хэш-таблица
+    size_t memoryUsage() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        size_t chunkCount = (count + chunkSize - 1) >> chunkBits;
+        return chunkCount * chunkSize * sizeof(std::string) + textBytes +
+               ids.bucket_count() * sizeof(void*) +
+               ids.size() * (sizeof(std::pair<std::string_view, uint32_t>) + sizeof(void*));
+    }
+};
+
+// Строка, хранимая номером в AttributePool: 4 байта вместо std::string,
+// сравнение на равенство - сравнение номеров
+class InternedString {
+private:
+    uint32_t id = 0;
+
+public:
+    InternedString() {}
+    explicit InternedString(const std::string& value) : id(AttributePool::instance().intern(value)) {}
+
+    const std::string& str() const { return AttributePool::instance().get(id); }
+    uint32_t getId() const { return id; }
+    bool empty() const { return id == 0; }
+
+    bool operator==(const InternedString& other) const { return id == other.id; }
+    bool operator!=(const InternedString& other) const { return id != other.id; }
+};
+
+// Набор ролей фиксированной ширины (128 бит). Роли 0..2 соответствуют уровням
+// доступа: уровень L дает роли 0..L-1, а ресурс уровня R требует роли 0..R-1,
+// поэтому для старых данных проверка ролей совпадает со сравнением уровней.
+// Роли 3..127 назначаются произвольно (группы, кафедры, особые разрешения).
+// Доступ есть, если у пользователя есть все роли, которых требует ресурс.
+struct alignas(16) RoleMask {
+    static constexpr unsigned bits = 128;
+    static constexpr unsigned firstCustomRole = 3;
+
+    uint64_t words[2] = {0, 0};
+
+    static RoleMask forLevel(int level) {
+        RoleMask mask;
+        if (level > 0) mask.words[0] = (uint64_t(1) << std::min(level, int(firstCustomRole))) - 1;
+        return mask;
+    }
+
+    static void checkCustomRole(unsigned role) {
+        if (role < firstCustomRole || role >= bits) {
+            throw InvalidInputException("Номер роли должен быть от " + std::to_string(firstCustomRole) + " до " +
+                                        std::to_string(bits - 1));
+        }
+    }
+
+    bool test(unsigned role) const { return (words[role / 64] >> (role % 64)) & 1; }
+    void set(unsigned role) { words[role / 64] |= uint64_t(1) << (role % 64); }
+    void reset(unsigned role) { words[role / 64] &= ~(uint64_t(1) << (role % 64)); }
+    bool hasLevelRoles() const { return (words[0] & ((uint64_t(1) << firstCustomRole) - 1)) != 0; }
+
+    // Есть ли в наборе все роли из required
+    bool covers(const RoleMask& required) const noexcept {
+        return ((required.words[0] & ~words[0]) | (required.words[1] & ~words[1])) == 0;
+    }
+
+    RoleMask operator|(const RoleMask& other) const {
+        RoleMask mask;
+        mask.words[0] = words[0] | other.words[0];
+        mask.words[1] = words[1] | other.words[1];
+        return mask;
+    }
+
+    bool operator==(const RoleMask& other) const {
+        return words[0] == other.words[0] && words[1] == other.words[1];
+    }
+    bool operator!=(const RoleMask& other) const { return !(*this == other); }
+};
+
+class User;
+class Resource;
+
+// Наблюдатель за изменениями пользователя (нужен системе для поддержки индексов).
+// Вызывается до изменения поля и может отменить его, выбросив исключение.
+class UserObserver {
+public:
+    virtual ~UserObserver() {}
+    virtual void userIdChanging(const User& user, int newId) = 0;
+    virtual void userNameChanging(const User& user, const std::string& newName) = 0;
+    virtual void userAccessLevelChanging(const User& user, int newLevel) = 0;
+    virtual void userAttributeChanging(const User& user, const std::string& newValue) = 0;
+    virtual void userRolesChanging(const User& user, const RoleMask& newRoles) = 0;
+};
+
+// Наблюдатель за изменениями ресурса
+class ResourceObserver {
+public:
+    virtual ~ResourceObserver() {}
+    virtual void resourceNameChanging(const Resource& resource, const std::string& newName) = 0;
+    virtual void resourceAccessLevelChanging(const Resource& resource, int newLevel) = 0;
+    virtual void resourceRolesChanging(const Resource& resource, const RoleMask& newRoles) = 0;
+};
+
 // Базовый класс пользователя
 class User {
 protected:
     std::string name;
     int id;
     int accessLevel; // 1 - студент, 2 - преподаватель, 3 - администратор
+    RoleMask customRoles; // дополнительные роли (без ролей уровня доступа)
+    UserObserver* observer = nullptr;
 
     void validate() const {
         if (name.empty()) {
@@ -38,34 +261,88 @@ protected:
         }
     }
 
+    // Пустой пользователь, поля которого заполняются loadFromFile
+    User() : id(0), accessLevel(0) {}
+
 public:
     User(const std::string& n, int i, int al) : name(n), id(i), accessLevel(al) {
         validate();
     }
 
+    // Копия не наблюдается системой, в которой находится оригинал
+    User(const User& other)
+        : name(other.name), id(other.id), accessLevel(other.accessLevel), customRoles(other.customRoles) {}
+
+    User& operator=(const User& other) {
+        name = other.name;
+        id = other.id;
+        accessLevel = other.accessLevel;
+        customRoles = other.customRoles;
+        return *this;
+    }
+
     virtual ~User() {}
 
+    void setObserver(UserObserver* o) { observer = o; }
+
     // Геттеры
-    std::string getName() const { return name; }
+    const std::string& getName() const { return name; }
     int getId() const { return id; }
     int getAccessLevel() const { return accessLevel; }
 
+    // Все роли пользователя: роли уровня доступа и дополнительные
+    RoleMask getRoles() const noexcept { return RoleMask::forLevel(accessLevel) | customRoles; }
+    const RoleMask& getCustomRoles() const { return customRoles; }
+
+    virtual UserKind getKind() const = 0;
+    // Группа, кафедра или должность в зависимости от типа
+    virtual const std::string& getAttribute() const = 0;
+    // Номер атрибута в AttributePool: у равных атрибутов номера равны
+    virtual uint32_t getAttributeId() const = 0;
+    // Изменение группы, кафедры или должности
+    virtual void setAttribute(const std::string& value) = 0;
+    // Глубокая копия без привязки к системе
+    virtual std::unique_ptr<User> clone() const = 0;
+
     // Сеттеры с проверкой
     void setName(const std::string& n) {
         if (n.empty()) throw InvalidInputException("Имя пользователя не может быть пустым");
+        if (observer && n != name) observer->userNameChanging(*this, n);
         name = n;
     }
 
     void setId(int i) {
         if (i <= 0) throw InvalidInputException("ID пользователя должен быть положительным числом");
+        if (observer && i != id) observer->userIdChanging(*this, i);
         id = i;
     }
 
     void setAccessLevel(int al) {
         if (al < 1 || al > 3) throw InvalidInputException("Уровень доступа должен быть от 1 до 3");
+        if (observer && al != accessLevel) observer->userAccessLevelChanging(*this, al);
         accessLevel = al;
     }
 
+    void setCustomRoles(const RoleMask& roles) {
+        if (roles.hasLevelRoles()) throw InvalidInputException("Роли уровня доступа задаются уровнем");
+        if (observer && roles != customRoles) observer->userRolesChanging(*this, roles);
+        customRoles = roles;
+    }
+
+    void grantRole(unsigned role) {
+        RoleMask::checkCustomRole(role);
+        RoleMask roles = customRoles;
+        roles.set(role);
+        setCustomRoles(roles);
+    }
+
+    void revokeRole(unsigned role) {
+        RoleMask::checkCustomRole(role);
+        RoleMask roles = customRoles;
+        roles.reset(role);
+        setCustomRoles(roles);
+    }
+
     // Виртуальный метод для вывода информации
     virtual void displayInfo() const {
         std::cout << "ID: " << id << ", Имя: " << name 
@@ -89,9 +366,11 @@ public:
 // Класс студента
 class Student : public User {
 private:
-    std::string group;
+    InternedString group;
 
 public:
+    Student() {} // для загрузки из файла
+
     Student(const std::string& n, int i, const std::string& g) 
         : User(n, i, 1), group(g) {
         if (group.empty()) throw InvalidInputException("Группа не может быть пустой");
@@ -99,33 +378,44 @@ public:
 
     void displayInfo() const override {
         User::displayInfo();
-        std::cout << ", Тип: Студент, Группа: " << group << std::endl;
+        std::cout << ", Тип: Студент, Группа: " << group.str() << std::endl;
     }
 
-    std::string getGroup() const { return group; }
+    std::string getGroup() const { return group.str(); }
+    UserKind getKind() const override { return UserKind::Student; }
+    const std::string& getAttribute() const override { return group.str(); }
+    uint32_t getAttributeId() const override { return group.getId(); }
+    void setAttribute(const std::string& value) override { setGroup(value); }
+    std::unique_ptr<User> clone() const override { return std::make_unique<Student>(*this); }
     void setGroup(const std::string& g) {
         if (g.empty()) throw InvalidInputException("Группа не может быть пустой");
-        group = g;
+        InternedString value(g);
+        if (observer && value != group) observer->userAttributeChanging(*this, g);
+        group = value;
     }
 
     void saveToFile(std::ofstream& out) const override {
         User::saveToFile(out);
-        out << group << "\n";
+        out << group.str() << "\n";
     }
 
     void loadFromFile(std::ifstream& in) override {
         User::loadFromFile(in);
-        std::getline(in, group);
-        if (group.empty()) throw InvalidInputException("Группа не может быть пустой");
+        std::string value;
+        std::getline(in, value);
+        if (value.empty()) throw InvalidInputException("Группа не может быть пустой");
+        group = InternedString(value);
     }
 };
 
 // Класс преподавателя
 class Teacher : public User {
 private:
-    std::string department;
+    InternedString department;
 
 public:
+    Teacher() {} // для загрузки из файла
+
     Teacher(const std::string& n, int i, const std::string& d) 
         : User(n, i, 2), department(d) {
         if (department.empty()) throw InvalidInputException("Кафедра не может быть пустой");
@@ -133,33 +423,44 @@ public:
 
     void displayInfo() const override {
         User::displayInfo();
-        std::cout << ", Тип: Преподаватель, Кафедра: " << department << std::endl;
+        std::cout << ", Тип: Преподаватель, Кафедра: " << department.str() << std::endl;
     }
 
-    std::string getDepartment() const { return department; }
+    std::string getDepartment() const { return department.str(); }
+    UserKind getKind() const override { return UserKind::Teacher; }
+    const std::string& getAttribute() const override { return department.str(); }
+    uint32_t getAttributeId() const override { return department.getId(); }
+    void setAttribute(const std::string& value) override { setDepartment(value); }
+    std::unique_ptr<User> clone() const override { return std::make_unique<Teacher>(*this); }
     void setDepartment(const std::string& d) {
         if (d.empty()) throw InvalidInputException("Кафедра не может быть пустой");
-        department = d;
+        InternedString value(d);
+        if (observer && value != department) observer->userAttributeChanging(*this, d);
+        department = value;
     }
 
     void saveToFile(std::ofstream& out) const override {
         User::saveToFile(out);
-        out << department << "\n";
+        out << department.str() << "\n";
     }
 
     void loadFromFile(std::ifstream& in) override {
         User::loadFromFile(in);
-        std::getline(in, department);
-        if (department.empty()) throw InvalidInputException("Кафедра не может быть пустой");
+        std::string value;
+        std::getline(in, value);
+        if (value.empty()) throw InvalidInputException("Кафедра не может быть пустой");
+        department = InternedString(value);
     }
 };
 
 // Класс администратора
 class Administrator : public User {
 private:
-    std::string position;
+    InternedString position;
 
 public:
+    Administrator() {} // для загрузки из файла
+
     Administrator(const std::string& n, int i, const std::string& p) 
         : User(n, i, 3), position(p) {
         if (position.empty()) throw InvalidInputException("Должность не может быть пустой");
@@ -167,49 +468,113 @@ public:
 
     void displayInfo() const override {
         User::displayInfo();
-        std::cout << ", Тип: Администратор, Должность: " << position << std::endl;
+        std::cout << ", Тип: Администратор, Должность: " << position.str() << std::endl;
     }
 
-    std::string getPosition() const { return position; }
+    std::string getPosition() const { return position.str(); }
+    UserKind getKind() const override { return UserKind::Administrator; }
+    const std::string& getAttribute() const override { return position.str(); }
+    uint32_t getAttributeId() const override { return position.getId(); }
+    void setAttribute(const std::string& value) override { setPosition(value); }
+    std::unique_ptr<User> clone() const override { return std::make_unique<Administrator>(*this); }
     void setPosition(const std::string& p) {
         if (p.empty()) throw InvalidInputException("Должность не может быть пустой");
-        position = p;
+        InternedString value(p);
+        if (observer && value != position) observer->userAttributeChanging(*this, p);
+        position = value;
     }
 
     void saveToFile(std::ofstream& out) const override {
         User::saveToFile(out);
-        out << position << "\n";
+        out << position.str() << "\n";
     }
 
     void loadFromFile(std::ifstream& in) override {
         User::loadFromFile(in);
-        std::getline(in, position);
-        if (position.empty()) throw InvalidInputException("Должность не может быть пустой");
+        std::string value;
+        std::getline(in, value);
+        if (value.empty()) throw InvalidInputException("Должность не может быть пустой");
+        position = InternedString(value);
     }
 };
 
+// Создание пользователя по тегу типа (для загрузчиков)
+std::unique_ptr<User> makeUser(UserKind kind, const std::string& name, int id, const std::string& attribute) {
+    switch (kind) {
+        case UserKind::Student: return std::make_unique<Student>(name, id, attribute);
+        case UserKind::Teacher: return std::make_unique<Teacher>(name, id, attribute);
+        case UserKind::Administrator: return std::make_unique<Administrator>(name, id, attribute);
+    }
+    throw InvalidInputException("Неизвестный тип пользователя");
+}
+
 // Класс ресурса университета
 class Resource {
 private:
     std::string name;
     int requiredAccessLevel;
+    RoleMask customRoles; // роли, которые требуются сверх уровня доступа
+    ResourceObserver* observer = nullptr;
 
 public:
+    Resource() : requiredAccessLevel(0) {} // для загрузки из файла
+
     Resource(const std::string& n, int ral) : name(n), requiredAccessLevel(ral) {
         if (name.empty()) throw InvalidInputException("Название ресурса не может быть пустым");
         if (ral < 1 || ral > 3) throw InvalidInputException("Требуемый уровень доступа должен быть от 1 до 3");
     }
 
-    std::string getName() const { return name; }
+    // Копия не наблюдается системой; перемещение (при росте вектора) сохраняет наблюдателя
+    Resource(const Resource& other)
+        : name(other.name), requiredAccessLevel(other.requiredAccessLevel), customRoles(other.customRoles) {}
+    Resource(Resource&& other) noexcept = default;
+
+    Resource& operator=(const Resource& other) {
+        name = other.name;
+        requiredAccessLevel = other.requiredAccessLevel;
+        customRoles = other.customRoles;
+        return *this;
+    }
+    Resource& operator=(Resource&& other) noexcept = default;
+
+    void setObserver(ResourceObserver* o) { observer = o; }
+
+    const std::string& getName() const { return name; }
     int getRequiredAccessLevel() const { return requiredAccessLevel; }
 
+    // Все требуемые роли: роли уровня доступа и дополнительные
+    RoleMask getRequiredRoles() const noexcept { return RoleMask::forLevel(requiredAccessLevel) | customRoles; }
+    const RoleMask& getCustomRoles() const { return customRoles; }
+
+    void setCustomRoles(const RoleMask& roles) {
+        if (roles.hasLevelRoles()) throw InvalidInputException("Роли уровня доступа задаются уровнем");
+        if (observer && roles != customRoles) observer->resourceRolesChanging(*this, roles);
+        customRoles = roles;
+    }
+
+    void requireRole(unsigned role) {
+        RoleMask::checkCustomRole(role);
+        RoleMask roles = customRoles;
+        roles.set(role);
+        setCustomRoles(roles);
+    }
+
+    void releaseRole(unsigned role) {
+        RoleMask::checkCustomRole(role);
+        RoleMask roles = customRoles;
+        roles.reset(role);
+        setCustomRoles(roles);
+    }
+
     void setName(const std::string& n) {
         if (n.empty()) throw InvalidInputException("Название ресурса не может быть пустым");
+        if (observer && n != name) observer->resourceNameChanging(*this, n);
         name = n;
     }
 
     void setRequiredAccessLevel(int ral) {
         if (ral < 1 || ral > 3) throw InvalidInputException("Требуемый уровень доступа должен быть от 1 до 3");
+        if (observer && ral != requiredAccessLevel) observer->resourceAccessLevelChanging(*this, ral);
         requiredAccessLevel = ral;
     }
 
@@ -218,8 +583,8 @@ public:
                   << requiredAccessLevel << std::endl;
     }
 
-    bool checkAccess(const User& user) const {
-        return user.getAccessLevel() >= requiredAccessLevel;
+    bool checkAccess(const User& user) const noexcept {
+        return user.getRoles().covers(getRequiredRoles());
     }
 
     void saveToFile(std::ofstream& out) const {
@@ -236,207 +601,4320 @@ public:
     }
 };
 
-// Шаблонный класс системы контроля доступа
-template<typename T>
-class AccessControlSystem {
-private:
-    std::vector<std::unique_ptr<User>> users;
-    std::vector<T> resources;
+// Приведение имени к нижнему регистру для поиска без учета регистра.
+// Обрабатываются латиница и кириллица в UTF-8, "ё" считается равной "е".
+std::string foldName(const std::string& text) {
+    std::string folded;
+    folded.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 'A' && c <= 'Z') {
+            folded += static_cast<char>(c + ('a' - 'A'));
+        } else if ((c == 0xD0 || c == 0xD1) && i + 1 < text.size() &&
+                   (static_cast<unsigned char>(text[i + 1]) & 0xC0) == 0x80) {
+            unsigned code = ((c & 0x1F) << 6) | (static_cast<unsigned char>(text[++i]) & 0x3F);
+            if (code >= 0x410 && code <= 0x42F) code += 0x20;      // А-Я
+            else if (code >= 0x400 && code <= 0x40F) code += 0x50; // Ѐ-Џ
+            if (code == 0x451) code = 0x435;                       // ё -> е
+            folded += static_cast<char>(0xC0 | (code >> 6));
+            folded += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            folded += static_cast<char>(c);
+        }
+    }
+    return folded;
+}
+
+// Тип пользователя по названию (английскому или русскому, без учета регистра)
+bool parseUserKind(const std::string& type, UserKind& kind) {
+    std::string folded = foldName(type);
+    if (folded == "student" || folded == "студент") kind = UserKind::Student;
+    else if (folded == "teacher" || folded == "преподаватель") kind = UserKind::Teacher;
+    else if (folded == "administrator" || folded == "администратор") kind = UserKind::Administrator;
+    else return false;
+    return true;
+}
 
+// Индекс имен для поиска по началу имени или любого слова в нем.
+// Ключи хранятся в нижнем регистре (foldName) в упорядоченных деревьях,
+// поэтому поиск по префиксу - это диапазон от lower_bound.
+class NameIndex {
 public:
-    void addUser(std::unique_ptr<User> user) {
-        users.push_back(std::move(user));
-    }
+    using Map = std::multimap<std::string, User*>;
 
-    void addResource(const T& resource) {
-        resources.push_back(resource);
+    // Легковесный диапазон найденных пользователей. Действителен,
+    // пока в систему не вносятся изменения.
+    class Range {
+    private:
+        Map::const_iterator first, last;
+
+    public:
+        class iterator {
+        private:
+            Map::const_iterator it;
+        public:
+            explicit iterator(Map::const_iterator i) : it(i) {}
+            const User& operator*() const { return *it->second; }
+            const User* operator->() const { return it->second; }
+            iterator& operator++() { ++it; return *this; }
+            bool operator!=(const iterator& other) const { return it != other.it; }
+            bool operator==(const iterator& other) const { return it == other.it; }
+        };
+
+        Range(Map::const_iterator f, Map::const_iterator l) : first(f), last(l) {}
+        iterator begin() const { return iterator(first); }
+        iterator end() const { return iterator(last); }
+        bool empty() const { return first == last; }
+        size_t size() const { return static_cast<size_t>(std::distance(first, last)); }
+    };
+
+private:
+    Map fullNames; // имя целиком
+    Map words;     // суффиксы имени, начинающиеся со второго и следующих слов
+
+    static Map::const_iterator prefixEnd(const Map& map, Map::const_iterator it, const std::string& prefix) {
+        while (it != map.end() && it->first.compare(0, prefix.size(), prefix) == 0) ++it;
+        return it;
     }
 
-    void displayAllUsers() const {
-        for (const auto& user : users) {
-            user->displayInfo();
+    template<typename Fn>
+    static void forEachWordStart(const std::string& folded, Fn fn) {
+        for (size_t i = 1; i < folded.size(); ++i) {
+            if (folded[i - 1] == ' ' && folded[i] != ' ') fn(folded.substr(i));
         }
     }
 
-    void displayAllResources() const {
-        for (const auto& resource : resources) {
-            resource.displayInfo();
+    static void eraseEntry(Map& map, const std::string& key, const User* user) {
+        auto range = map.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == user) {
+                map.erase(it);
+                return;
+            }
         }
     }
 
-    bool checkAccess(int userId, const std::string& resourceName) const {
-        auto userIt = std::find_if(users.begin(), users.end(), 
-            [userId](const std::unique_ptr<User>& u) { return u->getId() == userId; });
-        
-        auto resourceIt = std::find_if(resources.begin(), resources.end(), 
-            [resourceName](const T& r) { return r.getName() == resourceName; });
+public:
+    void add(User* user, const std::string& name) {
+        std::string folded = foldName(name);
+        forEachWordStart(folded, [&](std::string word) { words.emplace(std::move(word), user); });
+        fullNames.emplace(std::move(folded), user);
+    }
 
-        if (userIt == users.end()) {
-            throw std::runtime_error("Пользователь с ID " + std::to_string(userId) + " не найден");
-        }
+    void remove(const User* user, const std::string& name) {
+        std::string folded = foldName(name);
+        forEachWordStart(folded, [&](const std::string& word) { eraseEntry(words, word, user); });
+        eraseEntry(fullNames, folded, user);
+    }
 
-        if (resourceIt == resources.end()) {
-            throw std::runtime_error("Ресурс с именем " + resourceName + " не найден");
-        }
+    void clear() {
+        fullNames.clear();
+        words.clear();
+    }
+
+    // Пользователи, чье имя (без учета регистра) совпадает с name
+    Range equal(const std::string& name) const {
+        auto range = fullNames.equal_range(foldName(name));
+        return Range(range.first, range.second);
+    }
+
+    // Пользователи, чье имя начинается с prefix, в порядке имен
+    Range withPrefix(const std::string& prefix) const {
+        std::string folded = foldName(prefix);
+        auto first = fullNames.lower_bound(folded);
+        return Range(first, prefixEnd(fullNames, first, folded));
+    }
 
-        if (!resourceIt->checkAccess(**userIt)) {
-            throw AccessDeniedException("Доступ запрещен для пользователя " + (*userIt)->getName() + 
-                                       " к ресурсу " + resourceName);
+    // Пользователи, у которых с prefix начинается любое слово имени (не больше limit)
+    std::vector<const User*> withWordPrefix(const std::string& prefix, size_t limit) const {
+        std::string folded = foldName(prefix);
+        std::vector<const User*> found;
+        std::unordered_set<const User*> seen;
+        for (const Map* map : {&fullNames, &words}) {
+            for (auto it = map->lower_bound(folded); it != map->end() && found.size() < limit; ++it) {
+                if (it->first.compare(0, folded.size(), folded) != 0) break;
+                if (seen.insert(it->second).second) found.push_back(it->second);
+            }
         }
+        return found;
+    }
+};
 
-        return true;
+// Упорядоченное представление пользователей. Поддерживается при каждом
+// изменении вместо полной пересортировки; Key хранит заранее вычисленные
+// поля сравнения, поэтому сравнения не вызывают виртуальных методов и не выделяют память.
+template<typename Key>
+class SortedUserView {
+private:
+    std::set<Key> entries;
+
+public:
+    class iterator {
+    private:
+        typename std::set<Key>::const_iterator it;
+    public:
+        explicit iterator(typename std::set<Key>::const_iterator i) : it(i) {}
+        const User& operator*() const { return *it->user; }
+        const User* operator->() const { return it->user; }
+        iterator& operator++() { ++it; return *this; }
+        bool operator!=(const iterator& other) const { return it != other.it; }
+        bool operator==(const iterator& other) const { return it == other.it; }
+    };
+
+    void insert(User* user) { entries.insert(Key(*user)); }
+    void insertKey(Key key) { entries.insert(std::move(key)); }
+    void erase(const User* user) { entries.erase(Key(*user)); }
+    void clear() { entries.clear(); }
+
+    iterator begin() const { return iterator(entries.begin()); }
+    iterator end() const { return iterator(entries.end()); }
+    size_t size() const { return entries.size(); }
+
+    // Указатели пользователей в порядке представления
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        for (const Key& key : entries) fn(key.user);
     }
+};
 
-    void saveToFile(const std::string& filename) const {
-        std::ofstream out(filename);
-        if (!out) throw std::runtime_error("Не удалось открыть файл для записи");
+// Порядок по имени (побайтно, как в sortUsersByName), при равенстве - по ID
+struct NameOrderKey {
+    std::string name;
+    int id;
+    User* user;
 
-        // Сохраняем пользователей
-        out << users.size() << "\n";
-        for (const auto& user : users) {
-            user->saveToFile(out);
-        }
+    explicit NameOrderKey(const User& u) : name(u.getName()), id(u.getId()), user(const_cast<User*>(&u)) {}
 
-        // Сохраняем ресурсы
-        out << resources.size() << "\n";
-        for (const auto& resource : resources) {
-            resource.saveToFile(out);
-        }
+    bool operator<(const NameOrderKey& other) const {
+        int order = name.compare(other.name);
+        return order != 0 ? order < 0 : id < other.id;
     }
+};
 
-    void loadFromFile(const std::string& filename) {
-        std::ifstream in(filename);
-        if (!in) throw std::runtime_error("Не удалось открыть файл для чтения");
+// Порядок по уровню доступа, при равенстве - по ID
+struct AccessLevelOrderKey {
+    int level;
+    int id;
+    User* user;
 
-        users.clear();
-        resources.clear();
+    explicit AccessLevelOrderKey(const User& u)
+        : level(u.getAccessLevel()), id(u.getId()), user(const_cast<User*>(&u)) {}
 
-        // Загружаем пользователей
-        int userCount;
-        in >> userCount;
-        in.ignore();
+    bool operator<(const AccessLevelOrderKey& other) const {
+        return level != other.level ? level < other.level : id < other.id;
+    }
+};
 
-        for (int i = 0; i < userCount; ++i) {
-            std::string type;
-            std::getline(in, type);
-
-            std::unique_ptr<User> user;
-            if (type == typeid(Student).name()) {
-                user = std::make_unique<Student>("", 0, "");
-            } else if (type == typeid(Teacher).name()) {
-                user = std::make_unique<Teacher>("", 0, "");
-            } else if (type == typeid(Administrator).name()) {
-                user = std::make_unique<Administrator>("", 0, "");
-            } else {
-                throw std::runtime_error("Неизвестный тип пользователя в файле");
+// Пул рабочих потоков. parallelFor делит диапазон [0, count) на блоки,
+// которые разбирают рабочие потоки и вызывающий поток.
+class WorkerPool {
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::mutex runMutex; // одновременно выполняется только одна задача
+    std::condition_variable wakeUp;
+    std::condition_variable finished;
+    const std::function<void(size_t, size_t)>* task = nullptr;
+    size_t taskCount = 0;
+    size_t chunkSize = 1;
+    std::atomic<size_t> nextIndex{0};
+    std::exception_ptr error;
+    unsigned generation = 0;
+    unsigned busyWorkers = 0;
+    bool stopping = false;
+
+    void runChunks() {
+        while (true) {
+            size_t begin = nextIndex.fetch_add(chunkSize);
+            if (begin >= taskCount) break;
+            try {
+                (*task)(begin, std::min(begin + chunkSize, taskCount));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
             }
+        }
+    }
 
-            user->loadFromFile(in);
-            users.push_back(std::move(user));
+    void workerLoop() {
+        unsigned seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wakeUp.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            lock.unlock();
+            runChunks();
+            lock.lock();
+            if (--busyWorkers == 0) finished.notify_one();
         }
+    }
 
-        // Загружаем ресурсы
-        int resourceCount;
-        in >> resourceCount;
-        in.ignore();
+public:
+    explicit WorkerPool(unsigned threadCount) {
+        for (unsigned i = 1; i < threadCount; ++i) {
+            threads.emplace_back(&WorkerPool::workerLoop, this);
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
 
-        for (int i = 0; i < resourceCount; ++i) {
-            T resource("", 0);
-            resource.loadFromFile(in);
-            resources.push_back(resource);
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
         }
+        wakeUp.notify_all();
+        for (auto& thread : threads) thread.join();
     }
 
-    void findUserByName(const std::string& name) const {
-        bool found = false;
-        for (const auto& user : users) {
-            if (user->getName() == name) {
-                user->displayInfo();
-                found = true;
-            }
+    unsigned size() const { return static_cast<unsigned>(threads.size()) + 1; }
+
+    // Первое исключение из fn пробрасывается вызывающему после завершения всех блоков
+    void parallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& fn) {
+        if (count == 0) return;
+        if (threads.empty() || count <= minChunk) {
+            fn(0, count);
+            return;
         }
-        if (!found) {
-            std::cout << "Пользователь с именем " << name << " не найден" << std::endl;
+
+        std::lock_guard<std::mutex> run(runMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &fn;
+            taskCount = count;
+            chunkSize = std::max(minChunk, count / (size() * 4) + 1);
+            nextIndex = 0;
+            error = nullptr;
+            busyWorkers = static_cast<unsigned>(threads.size());
+            ++generation;
         }
+        wakeUp.notify_all();
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return busyWorkers == 0; });
+        if (error) std::rethrow_exception(error);
     }
+};
 
-    void findUserById(int id) const {
-        bool found = false;
-        for (const auto& user : users) {
-            if (user->getId() == id) {
-                user->displayInfo();
-                found = true;
-                break;
-            }
+// Файл, отображенный в память только для чтения
+class MappedFile {
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+
+public:
+    explicit MappedFile(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Не удалось открыть файл для чтения");
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Не удалось определить размер файла");
         }
-        if (!found) {
-            std::cout << "Пользователь с ID " << id << " не найден" << std::endl;
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Не удалось отобразить файл в память");
+            }
+            ::madvise(mapped, length, MADV_SEQUENTIAL);
+            bytes = static_cast<const char*>(mapped);
         }
+        ::close(fd);
     }
 
-    void sortUsersByAccessLevel() {
-        std::sort(users.begin(), users.end(), 
-            [](const std::unique_ptr<User>& a, const std::unique_ptr<User>& b) {
-                return a->getAccessLevel() < b->getAccessLevel();
-            });
-    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
 
-    void sortUsersByName() {
-        std::sort(users.begin(), users.end(), 
-            [](const std::unique_ptr<User>& a, const std::unique_ptr<User>& b) {
-                return a->getName() < b->getName();
-            });
+    ~MappedFile() {
+        if (bytes) ::munmap(const_cast<char*>(bytes), length);
     }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
 };
 
-// Функция для создания пользователя
-std::unique_ptr<User> createUser() {
-    std::cout << "Выберите тип пользователя:\n";
-    std::cout << "1. Студент\n";
-    std::cout << "2. Преподаватель\n";
-    std::cout << "3. Администратор\n";
-    std::cout << "Введите номер: ";
+// Заменяет filename записанным временным файлом так, чтобы после сбоя на
+// диске оказался либо старый, либо новый файл целиком: данные временного
+// файла сбрасываются на диск до rename, а каталог - после него.
+inline void replaceFileDurably(const std::string& tempName, const std::string& filename) {
+    int fd = ::open(tempName.c_str(), O_RDONLY);
+    bool ok = fd >= 0 && ::fsync(fd) == 0;
+    if (fd >= 0) ::close(fd);
+    if (!ok || std::rename(tempName.c_str(), filename.c_str()) != 0) {
+        throw std::runtime_error("Не удалось записать файл " + filename);
+    }
+    size_t slash = filename.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : filename.substr(0, slash == 0 ? 1 : slash);
+    int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    ok = dirFd >= 0 && ::fsync(dirFd) == 0;
+    if (dirFd >= 0) ::close(dirFd);
+    if (!ok) throw std::runtime_error("Не удалось сбросить на диск каталог " + directory);
+}
 
-    int type;
-    std::cin >> type;
-    std::cin.ignore();
+// Бинарный снимок системы. После заголовка идут колонки, каждая выровнена на 8 байт:
+//   ID пользователей (int32), теги типов (uint8), уровни доступа (uint8),
+//   ссылки на имена и атрибуты (StringRef), уровни ресурсов (uint8),
+//   ссылки на названия ресурсов (StringRef) и таблица строк.
+// Повторяющиеся атрибуты (группы, кафедры) хранятся в таблице строк один раз.
+// Версия 2 добавляет перед таблицей строк дополнительные роли пользователей
+// и ресурсов (RoleMask); снимки версии 1 читаются без ролей.
+namespace snapshot {
+    const char magic[4] = {'A', 'C', 'S', 'B'};
+    const uint32_t version = 2;
+    const uint32_t byteOrderMark = 0x01020304;
 
-    std::string name;
-    std::cout << "Введите имя: ";
-    std::getline(std::cin, name);
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t journalGeneration; // поколение журнала, изменения которого уже учтены в снимке
+        uint64_t userCount;
+        uint64_t resourceCount;
+        uint64_t stringBytes;
+    };
 
-    int id;
-    std::cout << "Введите ID: ";
-    std::cin >> id;
-    std::cin.ignore();
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
 
-    try {
-        switch (type) {
-            case 1: {
-                std::string group;
-                std::cout << "Введите группу: ";
-                std::getline(std::cin, group);
-                return std::make_unique<Student>(name, id, group);
-            }
-            case 2: {
-                std::string department;
-                std::cout << "Введите кафедру: ";
-                std::getline(std::cin, department);
-                return std::make_unique<Teacher>(name, id, department);
-            }
-            case 3: {
-                std::string position;
-                std::cout << "Введите должность: ";
-                std::getline(std::cin, position);
-                return std::make_unique<Administrator>(name, id, position);
+    struct Layout {
+        size_t userIds, userKinds, userLevels, userNames, userAttributes;
+        size_t resourceLevels, resourceNames, userRoles, resourceRoles, strings, total;
+
+        Layout(uint32_t fileVersion, uint64_t userCount, uint64_t resourceCount, uint64_t stringBytes) {
+            size_t offset = sizeof(Header);
+            auto column = [&offset](uint64_t bytes) {
+                size_t start = offset;
+                offset = (offset + bytes + 7) & ~size_t(7);
+                return start;
+            };
+            userIds = column(userCount * sizeof(int32_t));
+            userKinds = column(userCount);
+            userLevels = column(userCount);
+            userNames = column(userCount * sizeof(StringRef));
+            userAttributes = column(userCount * sizeof(StringRef));
+            resourceLevels = column(resourceCount);
+            resourceNames = column(resourceCount * sizeof(StringRef));
+            userRoles = column(fileVersion >= 2 ? userCount * sizeof(RoleMask) : 0);
+            resourceRoles = column(fileVersion >= 2 ? resourceCount * sizeof(RoleMask) : 0);
+            strings = column(stringBytes);
+            total = strings + stringBytes;
+        }
+    };
+
+    // Таблица строк, в которой одинаковые строки можно хранить один раз
+    class StringTableBuilder {
+    private:
+        std::string bytes;
+        std::unordered_map<std::string, StringRef> shared;
+
+    public:
+        StringRef add(const std::string& value) {
+            if (bytes.size() + value.size() > UINT32_MAX) {
+                throw std::runtime_error("Слишком большая таблица строк для снимка");
             }
-            default:
-                throw InvalidInputException("Неверный тип пользователя");
+            StringRef ref{static_cast<uint32_t>(bytes.size()), static_cast<uint32_t>(value.size())};
+            bytes += value;
+            return ref;
         }
-    } catch (const InvalidInputException& e) {
-        std::cerr << "Ошибка: " << e.what() << std::endl;
-        return nullptr;
-    }
+
+        StringRef addShared(const std::string& value) {
+            auto it = shared.find(value);
+            if (it != shared.end()) return it->second;
+            StringRef ref = add(value);
+            shared.emplace(value, ref);
+            return ref;
+        }
+
+        const std::string& data() const { return bytes; }
+    };
+}
+
+// Ограниченный кэш решений о доступе с вытеснением по алгоритму CLOCK.
+// Записи одного пользователя и одного ресурса связаны в списки, поэтому при
+// изменении пользователя или ресурса удаляются ровно зависящие от него решения.
+class DecisionCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t invalidations = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+private:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Entry {
+        int userId = 0;
+        std::string resource;
+        size_t hash = 0;
+        AccessDecision decision = AccessDecision::Denied;
+        bool used = false;
+        bool referenced = false;
+        uint32_t prevUser = none, nextUser = none;
+        uint32_t prevResource = none, nextResource = none;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<uint32_t> freeEntries;
+    std::vector<uint32_t> table; // открытая адресация: номер записи + 1, 0 - пусто
+    size_t mask = 0;
+    size_t hand = 0;
+    std::unordered_map<int, uint32_t> userLists;
+    std::unordered_map<std::string, uint32_t> resourceLists;
+    Stats stats;
+
+    static size_t hashKey(int userId, const std::string& resource) {
+        size_t h = std::hash<std::string>()(resource);
+        return h ^ (static_cast<size_t>(static_cast<uint32_t>(userId)) * 0x9E3779B97F4A7C15ull);
+    }
+
+    size_t findPosition(uint32_t entry) const {
+        size_t pos = entries[entry].hash & mask;
+        while (table[pos] != entry + 1) pos = (pos + 1) & mask;
+        return pos;
+    }
+
+    // Удаление из таблицы со сдвигом следующих записей цепочки назад
+    void eraseFromTable(size_t pos) {
+        size_t hole = pos;
+        size_t next = pos;
+        while (true) {
+            next = (next + 1) & mask;
+            if (table[next] == 0) break;
+            size_t home = entries[table[next] - 1].hash & mask;
+            bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+            if (!stays) {
+                table[hole] = table[next];
+                hole = next;
+            }
+        }
+        table[hole] = 0;
+    }
+
+    void remove(uint32_t index) {
+        Entry& e = entries[index];
+        if (e.prevUser != none) entries[e.prevUser].nextUser = e.nextUser;
+        else if (e.nextUser != none) userLists[e.userId] = e.nextUser;
+        else userLists.erase(e.userId);
+        if (e.nextUser != none) entries[e.nextUser].prevUser = e.prevUser;
+
+        if (e.prevResource != none) entries[e.prevResource].nextResource = e.nextResource;
+        else if (e.nextResource != none) resourceLists[e.resource] = e.nextResource;
+        else resourceLists.erase(e.resource);
+        if (e.nextResource != none) entries[e.nextResource].prevResource = e.prevResource;
+
+        eraseFromTable(findPosition(index));
+        e.used = false;
+        freeEntries.push_back(index);
+        --stats.size;
+    }
+
+    uint32_t takeFreeEntry() {
+        if (!freeEntries.empty()) {
+            uint32_t index = freeEntries.back();
+            freeEntries.pop_back();
+            return index;
+        }
+        while (true) {
+            Entry& e = entries[hand];
+            uint32_t index = static_cast<uint32_t>(hand);
+            hand = (hand + 1) % entries.size();
+            if (e.referenced) {
+                e.referenced = false;
+            } else {
+                remove(index);
+                ++stats.evictions;
+                freeEntries.pop_back();
+                return index;
+            }
+        }
+    }
+
+public:
+    explicit DecisionCache(size_t capacity) : entries(capacity) {
+        if (capacity == 0 || capacity >= none) throw InvalidInputException("Неверный размер кэша");
+        size_t tableSize = 1;
+        while (tableSize < capacity * 2) tableSize <<= 1;
+        table.assign(tableSize, 0);
+        mask = tableSize - 1;
+        stats.capacity = capacity;
+        freeEntries.reserve(capacity);
+        for (size_t i = capacity; i-- > 0;) freeEntries.push_back(static_cast<uint32_t>(i));
+    }
+
+    bool lookup(int userId, const std::string& resource, AccessDecision& decision) {
+        size_t hash = hashKey(userId, resource);
+        for (size_t pos = hash & mask; table[pos] != 0; pos = (pos + 1) & mask) {
+            Entry& e = entries[table[pos] - 1];
+            if (e.hash == hash && e.userId == userId && e.resource == resource) {
+                e.referenced = true;
+                decision = e.decision;
+                ++stats.hits;
+                return true;
+            }
+        }
+        ++stats.misses;
+        return false;
+    }
+
+    // Ключ не должен уже быть в кэше (вызывается после неудачного lookup)
+    void insert(int userId, const std::string& resource, AccessDecision decision) {
+        uint32_t index = takeFreeEntry();
+        Entry& e = entries[index];
+        e.userId = userId;
+        e.resource = resource;
+        e.hash = hashKey(userId, resource);
+        e.decision = decision;
+        e.used = true;
+        e.referenced = false;
+
+        e.prevUser = none;
+        auto user = userLists.emplace(userId, index);
+        e.nextUser = user.second ? none : user.first->second;
+        if (!user.second) {
+            entries[e.nextUser].prevUser = index;
+            user.first->second = index;
+        }
+        e.prevResource = none;
+        auto res = resourceLists.emplace(resource, index);
+        e.nextResource = res.second ? none : res.first->second;
+        if (!res.second) {
+            entries[e.nextResource].prevResource = index;
+            res.first->second = index;
+        }
+
+        size_t pos = e.hash & mask;
+        while (table[pos] != 0) pos = (pos + 1) & mask;
+        table[pos] = index + 1;
+        ++stats.size;
+    }
+
+    void invalidateUser(int userId) {
+        auto it = userLists.find(userId);
+        if (it == userLists.end()) return;
+        for (uint32_t index = it->second; index != none;) {
+            uint32_t next = entries[index].nextUser;
+            remove(index);
+            ++stats.invalidations;
+            index = next;
+        }
+    }
+
+    void invalidateResource(const std::string& resource) {
+        auto it = resourceLists.find(resource);
+        if (it == resourceLists.end()) return;
+        for (uint32_t index = it->second; index != none;) {
+            uint32_t next = entries[index].nextResource;
+            remove(index);
+            ++stats.invalidations;
+            index = next;
+        }
+    }
+
+    void clear() {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].used) remove(static_cast<uint32_t>(i));
+        }
+    }
+
+    const Stats& getStats() const { return stats; }
+};
+
+// Фильтр Блума для быстрого отказа по несуществующим ключам: mayContain
+// возвращает false только для ключей, которые точно не добавлялись.
+// Фильтр разбит на блоки по 512 бит (строка кэша): старшие биты хэша выбирают
+// блок, все биты ключа ставятся внутри него двойным хэшированием, поэтому
+// проверка стоит одного промаха кэша. Число блоков - степень двойки.
+// Удалять ключи нельзя, поэтому после удаления пользователя его ID
+// остается в фильтре (это лишь ложное срабатывание).
+// mayContain можно вызывать из нескольких потоков, add - только при
+// монопольном доступе. Счетчики отказов и ложных срабатываний могут быть
+// общими у нескольких фильтров (shareCounters): так они не обнуляются, когда
+// фильтр перестраивается или копируется в новую версию системы.
+class BloomFilter {
+public:
+    struct Stats {
+        size_t keys = 0;
+        size_t capacity = 0;
+        size_t bits = 0;
+        unsigned hashes = 0;
+        uint64_t rejected = 0;       // отказов без поиска в индексе
+        uint64_t falsePositives = 0; // ключ прошел фильтр, но не найден
+    };
+
+private:
+    static constexpr size_t blockWords = 8;
+
+    std::vector<uint64_t> words;
+    uint64_t blockMask = 0;
+    unsigned hashCount = 1;
+    size_t keyCount = 0;
+    size_t keyCapacity = 0;
+    double rate;
+
+    struct Counters {
+        std::atomic<uint64_t> rejected{0};
+        std::atomic<uint64_t> falsePositives{0};
+    };
+    std::shared_ptr<Counters> counters = std::make_shared<Counters>();
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDull;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ull;
+        return x ^ (x >> 33);
+    }
+
+public:
+    // capacity - ожидаемое число ключей, при котором достигается falsePositiveRate
+    BloomFilter(size_t capacity, double falsePositiveRate) : rate(falsePositiveRate) {
+        if (!(falsePositiveRate > 0 && falsePositiveRate < 1)) {
+            throw InvalidInputException("Доля ложных срабатываний должна быть от 0 до 1");
+        }
+        keyCapacity = std::max<size_t>(capacity, 64);
+        const double ln2 = 0.6931471805599453;
+        // Блоки заполняются неравномерно, поэтому бит берется на четверть больше расчетного
+        double bitsNeeded = -1.25 * double(keyCapacity) * std::log(falsePositiveRate) / (ln2 * ln2);
+        size_t blocks = 1;
+        while (double(blocks) * blockWords * 64 < bitsNeeded) blocks <<= 1;
+        words.assign(blocks * blockWords, 0);
+        blockMask = blocks - 1;
+        double optimal = double(words.size() * 64) / keyCapacity * ln2;
+        hashCount = static_cast<unsigned>(std::min(16.0, std::max(1.0, std::round(optimal))));
+    }
+
+    BloomFilter(const BloomFilter&) = delete;
+    BloomFilter& operator=(const BloomFilter&) = delete;
+
+    static uint64_t hash(int key) { return mix(static_cast<uint32_t>(key) + 0x9E3779B97F4A7C15ull); }
+    static uint64_t hash(std::string_view key) { return mix(std::hash<std::string_view>()(key)); }
+
+    void add(uint64_t h) {
+        uint64_t* block = &words[((h >> 40) & blockMask) * blockWords];
+        uint32_t bit = static_cast<uint32_t>(h), step = static_cast<uint32_t>(h >> 20) | 1;
+        for (unsigned i = 0; i < hashCount; ++i, bit += step) {
+            block[(bit >> 6) & 7] |= uint64_t(1) << (bit & 63);
+        }
+        ++keyCount;
+    }
+
+    bool mayContain(uint64_t h) const noexcept {
+        const uint64_t* block = &words[((h >> 40) & blockMask) * blockWords];
+        uint32_t bit = static_cast<uint32_t>(h), step = static_cast<uint32_t>(h >> 20) | 1;
+        for (unsigned i = 0; i < hashCount; ++i, bit += step) {
+            if (!(block[(bit >> 6) & 7] & (uint64_t(1) << (bit & 63)))) {
+                counters->rejected.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Вызывается, когда ключ прошел фильтр, но в индексе не нашелся
+    void noteFalsePositive() const noexcept { counters->falsePositives.fetch_add(1, std::memory_order_relaxed); }
+
+    // Ключей больше расчетного: доля ложных срабатываний выше заданной
+    bool full() const { return keyCount > keyCapacity; }
+    double falsePositiveRate() const { return rate; }
+
+    // Дальше считает в те же счетчики, что и other (фильтр, который заменяется
+    // этим при росте, или фильтр предыдущей версии системы)
+    void shareCounters(const BloomFilter& other) { counters = other.counters; }
+
+    Stats getStats() const {
+        Stats stats;
+        stats.keys = keyCount;
+        stats.capacity = keyCapacity;
+        stats.bits = words.size() * 64;
+        stats.hashes = hashCount;
+        stats.rejected = counters->rejected.load(std::memory_order_relaxed);
+        stats.falsePositives = counters->falsePositives.load(std::memory_order_relaxed);
+        return stats;
+    }
+};
+
+// Колоночное хранилище пользователей для сканирований и аналитики.
+// ID, уровни и типы лежат в непрерывных массивах, имена - подряд в одной
+// строке, атрибуты (группа/кафедра/должность) хранятся номерами AttributePool.
+// Фильтры обрабатывают строки блоками: сначала векторизуемый цикл сравнений
+// заполняет маску блока, затем по маске собираются подходящие ID.
+class ColumnarUserStore {
+private:
+    static constexpr size_t blockSize = 256;
+
+    std::vector<int32_t> ids;
+    std::vector<uint8_t> levels;
+    std::vector<uint8_t> kinds;
+    std::vector<uint32_t> attributeCodes; // номера строк в AttributePool
+    std::vector<uint32_t> nameOffsets{0};  // имя i: [nameOffsets[i], nameOffsets[i + 1])
+    std::string nameText;
+
+    static uint32_t appendText(std::string& target, std::string_view text) {
+        if (target.size() + text.size() > UINT32_MAX) {
+            throw std::runtime_error("Слишком много строк в колоночном хранилище");
+        }
+        target.append(text.data(), text.size());
+        return static_cast<uint32_t>(target.size());
+    }
+
+    template<typename Match, typename Emit>
+    void scan(Match match, Emit emit) const {
+        uint8_t selected[blockSize];
+        for (size_t base = 0; base < ids.size(); base += blockSize) {
+            size_t count = std::min(blockSize, ids.size() - base);
+            for (size_t i = 0; i < count; ++i) selected[i] = match(base + i);
+            for (size_t i = 0; i < count; ++i) {
+                if (selected[i]) emit(base + i);
+            }
+        }
+    }
+
+public:
+    static constexpr uint32_t noAttribute = UINT32_MAX;
+
+    void reserve(size_t count, size_t textBytes) {
+        ids.reserve(count);
+        levels.reserve(count);
+        kinds.reserve(count);
+        attributeCodes.reserve(count);
+        nameOffsets.reserve(count + 1);
+        nameText.reserve(textBytes);
+    }
+
+    void shrinkToFit() {
+        ids.shrink_to_fit();
+        levels.shrink_to_fit();
+        kinds.shrink_to_fit();
+        attributeCodes.shrink_to_fit();
+        nameOffsets.shrink_to_fit();
+        nameText.shrink_to_fit();
+    }
+
+    void append(const User& user) {
+        nameOffsets.push_back(appendText(nameText, user.getName()));
+        ids.push_back(user.getId());
+        levels.push_back(static_cast<uint8_t>(user.getAccessLevel()));
+        kinds.push_back(static_cast<uint8_t>(user.getKind()));
+        attributeCodes.push_back(user.getAttributeId());
+    }
+
+    size_t size() const { return ids.size(); }
+    int id(size_t row) const { return ids[row]; }
+    int accessLevel(size_t row) const { return levels[row]; }
+    UserKind kind(size_t row) const { return static_cast<UserKind>(kinds[row]); }
+
+    std::string_view name(size_t row) const {
+        return std::string_view(nameText).substr(nameOffsets[row], nameOffsets[row + 1] - nameOffsets[row]);
+    }
+
+    std::string_view attribute(size_t row) const {
+        return AttributePool::instance().get(attributeCodes[row]);
+    }
+
+    // Код атрибута или noAttribute, если такого значения нет
+    uint32_t attributeCode(const std::string& value) const {
+        uint32_t code;
+        return AttributePool::instance().find(value, code) ? code : noAttribute;
+    }
+
+    // ID пользователей с уровнем доступа не ниже minLevel и заданным атрибутом
+    std::vector<int> idsWithLevelAtLeast(int minLevel, const std::string& attribute) const {
+        std::vector<int> found;
+        uint32_t code = attributeCode(attribute);
+        if (code == noAttribute) return found;
+        const uint8_t level = static_cast<uint8_t>(std::max(0, std::min(minLevel, 255)));
+        const uint8_t* levelColumn = levels.data();
+        const uint32_t* codeColumn = attributeCodes.data();
+        scan([=](size_t row) { return static_cast<uint8_t>((levelColumn[row] >= level) & (codeColumn[row] == code)); },
+             [&](size_t row) { found.push_back(ids[row]); });
+        return found;
+    }
+
+    // Число пользователей с каждым уровнем доступа (индекс - уровень)
+    std::array<size_t, 4> countByAccessLevel() const {
+        std::array<size_t, 4> counts = {};
+        for (int level = 1; level <= 3; ++level) {
+            size_t count = 0;
+            for (uint8_t value : levels) count += value == level;
+            counts[level] = count;
+        }
+        return counts;
+    }
+
+    // Число пользователей с заданным атрибутом
+    size_t countWithAttribute(const std::string& attribute) const {
+        uint32_t code = attributeCode(attribute);
+        if (code == noAttribute) return 0;
+        size_t count = 0;
+        for (uint32_t value : attributeCodes) count += value == code;
+        return count;
+    }
+
+    // Байты, занятые колонками (общий AttributePool не учитывается)
+    size_t memoryUsage() const {
+        return ids.capacity() * sizeof(int32_t) + levels.capacity() + kinds.capacity() +
+               attributeCodes.capacity() * sizeof(uint32_t) + nameOffsets.capacity() * sizeof(uint32_t) +
+               nameText.capacity();
+    }
+};
+
+// Формат журнала изменений. Каждая запись:
+//   uint32 длина данных, uint8 тип, данные, uint32 контрольная сумма (FNV-1a от типа и данных).
+// Первая запись файла - Header с номером поколения. Запись с неверной суммой или
+// обрезанная запись в конце файла считается недописанной и отбрасывается.
+namespace journal {
+    enum class RecordType : uint8_t {
+        Header = 1,
+        AddUser,
+        RemoveUser,
+        SetUserId,
+        SetUserName,
+        SetUserAccessLevel,
+        SetUserAttribute,
+        AddResource,
+        SetResourceName,
+        SetResourceAccessLevel,
+        SortByName,
+        SortByAccessLevel,
+        SetUserRoles,
+        SetResourceRoles
+    };
+
+    inline uint32_t checksum(const char* data, size_t size) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    class RecordWriter {
+    private:
+        std::string bytes;
+
+        void putRaw(const void* data, size_t size) { bytes.append(static_cast<const char*>(data), size); }
+
+    public:
+        explicit RecordWriter(RecordType type) {
+            bytes.resize(sizeof(uint32_t));
+            bytes += static_cast<char>(type);
+        }
+
+        RecordWriter& u8(uint8_t value) { putRaw(&value, 1); return *this; }
+        RecordWriter& i32(int32_t value) { putRaw(&value, sizeof(value)); return *this; }
+        RecordWriter& u32(uint32_t value) { putRaw(&value, sizeof(value)); return *this; }
+        RecordWriter& u64(uint64_t value) { putRaw(&value, sizeof(value)); return *this; }
+        RecordWriter& roles(const RoleMask& value) { return u64(value.words[0]).u64(value.words[1]); }
+        RecordWriter& str(const std::string& value) {
+            u32(static_cast<uint32_t>(value.size()));
+            bytes += value;
+            return *this;
+        }
+
+        // Готовая запись с длиной и контрольной суммой
+        std::string finish() {
+            uint32_t length = static_cast<uint32_t>(bytes.size() - sizeof(uint32_t) - 1);
+            std::memcpy(&bytes[0], &length, sizeof(length));
+            uint32_t sum = checksum(bytes.data() + sizeof(uint32_t), bytes.size() - sizeof(uint32_t));
+            putRaw(&sum, sizeof(sum));
+            return std::move(bytes);
+        }
+    };
+
+    class RecordReader {
+    private:
+        const char* position;
+        const char* end;
+
+        void take(void* out, size_t size) {
+            if (static_cast<size_t>(end - position) < size) throw std::runtime_error("Запись журнала повреждена");
+            std::memcpy(out, position, size);
+            position += size;
+        }
+
+    public:
+        RecordReader(const char* data, size_t size) : position(data), end(data + size) {}
+
+        uint8_t u8() { uint8_t v; take(&v, 1); return v; }
+        int32_t i32() { int32_t v; take(&v, sizeof(v)); return v; }
+        uint32_t u32() { uint32_t v; take(&v, sizeof(v)); return v; }
+        uint64_t u64() { uint64_t v; take(&v, sizeof(v)); return v; }
+        RoleMask roles() {
+            RoleMask v;
+            v.words[0] = u64();
+            v.words[1] = u64();
+            return v;
+        }
+        std::string str() {
+            uint32_t length = u32();
+            if (static_cast<size_t>(end - position) < length) throw std::runtime_error("Запись журнала повреждена");
+            std::string value(position, length);
+            position += length;
+            return value;
+        }
+    };
+
+    // Обходит целые записи файла; возвращает размер корректной части файла
+    template<typename Fn>
+    size_t forEachRecord(const char* data, size_t size, Fn fn) {
+        const size_t overhead = sizeof(uint32_t) * 2 + 1;
+        size_t offset = 0;
+        while (size - offset >= overhead) {
+            uint32_t length, sum;
+            std::memcpy(&length, data + offset, sizeof(length));
+            if (length > size - offset - overhead) break;
+            const char* body = data + offset + sizeof(uint32_t);
+            std::memcpy(&sum, body + 1 + length, sizeof(sum));
+            if (sum != checksum(body, 1 + length)) break;
+            RecordReader reader(body + 1, length);
+            fn(static_cast<RecordType>(body[0]), reader);
+            offset += overhead + length;
+        }
+        return offset;
+    }
+
+    // Поколение из заголовка журнала; false, если файла нет или он пуст
+    inline bool readGeneration(const std::string& filename, uint32_t& generation, size_t& validBytes) {
+        struct stat info;
+        if (::stat(filename.c_str(), &info) != 0 || info.st_size == 0) return false;
+        MappedFile file(filename);
+        bool found = false;
+        validBytes = forEachRecord(file.data(), file.size(), [&](RecordType type, RecordReader& in) {
+            if (!found) {
+                if (type != RecordType::Header) throw std::runtime_error("Файл не является журналом изменений");
+                generation = in.u32();
+                found = true;
+            }
+        });
+        if (!found) throw std::runtime_error("Файл не является журналом изменений");
+        return true;
+    }
+}
+
+// Журнал с групповой фиксацией: append только добавляет запись в буфер, а
+// фоновый поток раз в commitInterval (или при накоплении groupCommitBytes)
+// пишет все накопленные записи одним write и одним fdatasync.
+class Journal {
+public:
+    struct Options {
+        std::chrono::milliseconds commitInterval{10};
+        size_t groupCommitBytes = 1 << 20;
+        uint64_t compactAfterBytes = 64 << 20; // 0 - сжатие только вручную
+    };
+
+    struct Stats {
+        uint64_t records = 0;
+        uint64_t commits = 0; // число fdatasync
+        uint64_t fileBytes = 0;
+    };
+
+private:
+    int fd = -1;
+    Options options;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable durable;
+    std::string pending;
+    uint64_t appended = 0; // номер последней добавленной записи
+    uint64_t written = 0;  // номер последней записи на диске
+    bool syncRequested = false;
+    bool stopping = false;
+    bool failed = false;
+    Stats stats;
+    std::thread committer;
+
+    bool writeAll(const std::string& data) {
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void commitLoop() {
+        std::string batch;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wakeUp.wait_for(lock, options.commitInterval, [&] {
+                return stopping || syncRequested || pending.size() >= options.groupCommitBytes;
+            });
+            syncRequested = false;
+            if (!pending.empty()) {
+                batch.swap(pending);
+                uint64_t upTo = appended;
+                lock.unlock();
+                bool ok = writeAll(batch) && ::fdatasync(fd) == 0;
+                lock.lock();
+                failed = failed || !ok;
+                written = upTo;
+                stats.fileBytes += batch.size();
+                ++stats.commits;
+                batch.clear();
+            }
+            durable.notify_all();
+            if (stopping && pending.empty()) return;
+        }
+    }
+
+public:
+    // Открывает файл на дозапись. validBytes - размер корректной части
+    // существующего файла: недописанный хвост обрезается.
+    Journal(const std::string& filename, uint32_t generation, bool exists, size_t validBytes, const Options& opts)
+        : options(opts) {
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) throw std::runtime_error("Не удалось открыть журнал изменений");
+        if (!exists) validBytes = 0;
+        if (::ftruncate(fd, static_cast<off_t>(validBytes)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Не удалось подготовить журнал изменений");
+        }
+        stats.fileBytes = validBytes;
+        if (!exists) {
+            std::string header = journal::RecordWriter(journal::RecordType::Header).u32(generation).finish();
+            if (!writeAll(header) || ::fdatasync(fd) != 0) {
+                ::close(fd);
+                throw std::runtime_error("Ошибка записи журнала изменений");
+            }
+            stats.fileBytes = header.size();
+        }
+        committer = std::thread(&Journal::commitLoop, this);
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Дописывает все накопленные записи
+    ~Journal() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_one();
+        committer.join();
+        ::close(fd);
+    }
+
+    void append(std::string record) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending += record;
+        ++appended;
+        ++stats.records;
+        if (pending.size() >= options.groupCommitBytes) wakeUp.notify_one();
+    }
+
+    // Ждет, пока все добавленные записи будут записаны на диск
+    void sync() {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t target = appended;
+        if (written < target) {
+            syncRequested = true;
+            wakeUp.notify_one();
+            durable.wait(lock, [&] { return written >= target; });
+        }
+        if (failed) throw std::runtime_error("Ошибка записи журнала изменений");
+    }
+
+    // Начинает журнал заново с новым поколением (после сжатия в снимок)
+    void restart(uint32_t generation) {
+        sync();
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string header = journal::RecordWriter(journal::RecordType::Header).u32(generation).finish();
+        if (::ftruncate(fd, 0) != 0 || !writeAll(header) || ::fdatasync(fd) != 0) {
+            failed = true;
+            throw std::runtime_error("Ошибка записи журнала изменений");
+        }
+        stats.fileBytes = header.size();
+    }
+
+    uint64_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats.fileBytes + pending.size();
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    const Options& getOptions() const { return options; }
+};
+
+// Формат файла аудита: заголовок, затем записи фиксированного размера.
+// Ресурс записывается хэшем FNV-1a названия, названия можно восстановить
+// по файлу данных при расшифровке (--decode-audit).
+namespace audit {
+    const char magic[4] = {'A', 'C', 'S', 'A'};
+    const uint32_t version = 2;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t recordSize;
+        uint32_t reserved;
+    };
+
+    struct Record {
+        uint64_t timestamp; // наносекунды с 1970 года
+        int32_t userId;
+        uint32_t resource;     // 64-битный FNV-1a названия ресурса:
+        uint32_t resourceHigh; // младшая и старшая половины
+        uint8_t decision;      // AccessDecision
+        uint8_t reserved[3];
+    };
+    static_assert(sizeof(Record) == 24, "Размер записи аудита входит в формат файла");
+
+    // 32 бит мало: среди 100 тысяч названий совпадения хэшей почти неизбежны
+    inline uint64_t resourceKey(const std::string& name) {
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : name) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    inline const char* decisionName(uint8_t decision) {
+        switch (static_cast<AccessDecision>(decision)) {
+            case AccessDecision::Allowed: return "разрешен";
+            case AccessDecision::Denied: return "запрещен";
+            case AccessDecision::UnknownUser: return "пользователь не найден";
+            case AccessDecision::UnknownResource: return "ресурс не найден";
+        }
+        return "?";
+    }
+}
+
+// Аудит решений о доступе. Каждый поток пишет в собственное кольцо
+// (один писатель, один читатель) без блокировок; фоновый поток забирает
+// записи из всех колец и дописывает их в файл крупными блоками.
+// Если кольцо заполнено, запись отбрасывается и учитывается в dropped:
+// проверка доступа никогда не ждет диска.
+class AuditTrail {
+public:
+    struct Options {
+        size_t ringCapacity = 1 << 16; // записей на поток, округляется до степени двойки
+        std::chrono::milliseconds flushInterval{50};
+        bool syncToDisk = true; // fdatasync после каждого блока
+    };
+
+    struct Stats {
+        uint64_t recorded = 0;
+        uint64_t dropped = 0;
+        uint64_t written = 0;
+        uint64_t flushes = 0;
+        size_t threads = 0;
+    };
+
+private:
+    struct Ring {
+        explicit Ring(size_t capacity) : records(capacity), mask(capacity - 1) {}
+
+        std::vector<audit::Record> records;
+        size_t mask;
+        alignas(64) std::atomic<uint64_t> head{0}; // пишет только поток-владелец
+        std::atomic<uint64_t> dropped{0};
+        alignas(64) std::atomic<uint64_t> tail{0}; // пишет только фоновый поток
+    };
+
+    // Кольцо текущего потока для последнего использованного журнала аудита
+    struct ThreadRing {
+        uint64_t trailId = 0;
+        Ring* ring = nullptr;
+    };
+
+    static std::atomic<uint64_t> nextTrailId;
+
+    const uint64_t trailId = nextTrailId.fetch_add(1) + 1;
+    int fd = -1;
+    Options options;
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::unordered_map<std::thread::id, Ring*> ringsByThread;
+    std::mutex flushMutex;
+    std::condition_variable wakeUp;
+    std::condition_variable flushed;
+    uint64_t flushRequests = 0;
+    uint64_t flushesDone = 0;
+    bool stopping = false;
+    std::atomic<bool> drainRequested{false}; // какое-то кольцо заполнено наполовину
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> flushes{0};
+    std::atomic<bool> failed{false};
+    std::thread writer;
+
+    Ring* threadRing() {
+        thread_local ThreadRing cached;
+        if (cached.trailId == trailId) return cached.ring;
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        // ID завершившегося потока может достаться новому: кольцо переходит к нему
+        Ring*& ring = ringsByThread[std::this_thread::get_id()];
+        if (!ring) {
+            rings.push_back(std::make_unique<Ring>(options.ringCapacity));
+            ring = rings.back().get();
+        }
+        cached.trailId = trailId;
+        cached.ring = ring;
+        return ring;
+    }
+
+    bool writeAll(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t n = ::write(fd, data, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Забирает записи из всех колец в буфер, записывая его по заполнении
+    void drain(std::vector<audit::Record>& buffer) {
+        std::vector<Ring*> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            for (const auto& ring : rings) snapshot.push_back(ring.get());
+        }
+        auto flush = [&] {
+            if (buffer.empty()) return;
+            bool ok = writeAll(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(audit::Record));
+            if (ok && options.syncToDisk) ok = ::fdatasync(fd) == 0;
+            if (!ok) failed.store(true);
+            written.fetch_add(buffer.size(), std::memory_order_relaxed);
+            flushes.fetch_add(1, std::memory_order_relaxed);
+            buffer.clear();
+        };
+        for (Ring* ring : snapshot) {
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            while (tail != head) {
+                size_t room = buffer.capacity() - buffer.size();
+                uint64_t count = std::min<uint64_t>(head - tail, room);
+                for (uint64_t i = 0; i < count; ++i) buffer.push_back(ring->records[(tail + i) & ring->mask]);
+                tail += count;
+                ring->tail.store(tail, std::memory_order_release);
+                if (buffer.size() == buffer.capacity()) flush();
+            }
+        }
+        flush();
+    }
+
+    void writeLoop() {
+        std::vector<audit::Record> buffer;
+        buffer.reserve((1 << 20) / sizeof(audit::Record));
+        std::unique_lock<std::mutex> lock(flushMutex);
+        while (true) {
+            wakeUp.wait_for(lock, options.flushInterval, [&] {
+                return stopping || flushRequests != flushesDone || drainRequested.load();
+            });
+            drainRequested.store(false);
+            uint64_t requested = flushRequests;
+            bool last = stopping;
+            lock.unlock();
+            drain(buffer);
+            lock.lock();
+            flushesDone = requested;
+            flushed.notify_all();
+            if (last) return;
+        }
+    }
+
+public:
+    // Открывает файл аудита на дозапись; новый файл начинается с заголовка
+    AuditTrail(const std::string& filename, const Options& opts) : options(opts) {
+        size_t capacity = 1;
+        while (capacity < std::max<size_t>(options.ringCapacity, 2)) capacity <<= 1;
+        options.ringCapacity = capacity;
+
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) throw std::runtime_error("Не удалось открыть файл аудита");
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Не удалось определить размер файла аудита");
+        }
+        if (info.st_size == 0) {
+            audit::FileHeader header = {};
+            std::memcpy(header.magic, audit::magic, sizeof(header.magic));
+            header.version = audit::version;
+            header.recordSize = sizeof(audit::Record);
+            if (!writeAll(reinterpret_cast<const char*>(&header), sizeof(header))) {
+                ::close(fd);
+                throw std::runtime_error("Ошибка записи файла аудита");
+            }
+        }
+        writer = std::thread(&AuditTrail::writeLoop, this);
+    }
+
+    AuditTrail(const AuditTrail&) = delete;
+    AuditTrail& operator=(const AuditTrail&) = delete;
+
+    // Дописывает все принятые записи
+    ~AuditTrail() {
+        {
+            std::lock_guard<std::mutex> lock(flushMutex);
+            stopping = true;
+        }
+        wakeUp.notify_one();
+        writer.join();
+        ::close(fd);
+    }
+
+    // Вызывается на пути проверки: без блокировок, кроме первого вызова в потоке
+    void record(int userId, const std::string& resourceName, AccessDecision decision) noexcept {
+        Ring* ring;
+        try {
+            ring = threadRing();
+        } catch (...) {
+            return;
+        }
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) > ring->mask) {
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        audit::Record& entry = ring->records[head & ring->mask];
+        entry.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        entry.userId = userId;
+        uint64_t key = audit::resourceKey(resourceName);
+        entry.resource = static_cast<uint32_t>(key);
+        entry.resourceHigh = static_cast<uint32_t>(key >> 32);
+        entry.decision = static_cast<uint8_t>(decision);
+        std::memset(entry.reserved, 0, sizeof(entry.reserved));
+        ring->head.store(head + 1, std::memory_order_release);
+        // Будим писателя заранее, не дожидаясь таймера. Уведомление без мьютекса
+        // может потеряться, тогда записи заберут по таймеру.
+        if (head - ring->tail.load(std::memory_order_relaxed) == ring->mask / 2 && !drainRequested.exchange(true)) {
+            wakeUp.notify_one();
+        }
+    }
+
+    // Ждет, пока все записи, принятые до вызова, окажутся в файле
+    void flush() {
+        std::unique_lock<std::mutex> lock(flushMutex);
+        uint64_t target = ++flushRequests;
+        wakeUp.notify_one();
+        flushed.wait(lock, [&] { return flushesDone >= target; });
+        if (failed.load()) throw std::runtime_error("Ошибка записи файла аудита");
+    }
+
+    Stats getStats() {
+        Stats stats;
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (const auto& ring : rings) {
+            stats.recorded += ring->head.load(std::memory_order_acquire);
+            stats.dropped += ring->dropped.load(std::memory_order_relaxed);
+        }
+        stats.written = written.load(std::memory_order_relaxed);
+        stats.flushes = flushes.load(std::memory_order_relaxed);
+        stats.threads = rings.size();
+        return stats;
+    }
+};
+
+std::atomic<uint64_t> AuditTrail::nextTrailId{0};
+
+// Выводит файл аудита в текстовом виде. Если задан файл данных (saveToFile),
+// хэши ресурсов заменяются их названиями. Хэш, общий для нескольких
+// названий, выводится как есть, чтобы не приписать запись чужому ресурсу.
+void decodeAuditFile(const std::string& filename, const std::vector<std::string>& resourceNames,
+                     std::ostream& out) {
+    MappedFile file(filename);
+    audit::FileHeader header;
+    if (file.size() < sizeof(header)) throw std::runtime_error("Файл аудита слишком мал");
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, audit::magic, sizeof(header.magic)) != 0 || header.version != audit::version ||
+        header.recordSize != sizeof(audit::Record)) {
+        throw std::runtime_error("Неверный формат файла аудита");
+    }
+    std::unordered_map<uint64_t, std::string> names;
+    std::unordered_set<uint64_t> ambiguous;
+    for (const auto& name : resourceNames) {
+        uint64_t key = audit::resourceKey(name);
+        auto inserted = names.emplace(key, name);
+        if (!inserted.second && inserted.first->second != name) ambiguous.insert(key);
+    }
+    for (uint64_t key : ambiguous) names.erase(key);
+    if (!ambiguous.empty()) {
+        std::cerr << "Хэши совпадают у разных названий ресурсов (" << ambiguous.size() << "), такие записи выводятся хэшами\n";
+    }
+
+    size_t count = (file.size() - sizeof(header)) / sizeof(audit::Record);
+    for (size_t i = 0; i < count; ++i) {
+        audit::Record record;
+        std::memcpy(&record, file.data() + sizeof(header) + i * sizeof(record), sizeof(record));
+        time_t seconds = static_cast<time_t>(record.timestamp / 1000000000);
+        struct tm parts;
+        gmtime_r(&seconds, &parts);
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &parts);
+        char fraction[16];
+        std::snprintf(fraction, sizeof(fraction), ".%09llu", static_cast<unsigned long long>(record.timestamp % 1000000000));
+        out << stamp << fraction << "Z\t" << record.userId << '\t';
+        uint64_t key = (static_cast<uint64_t>(record.resourceHigh) << 32) | record.resource;
+        auto it = names.find(key);
+        if (it != names.end()) {
+            out << it->second;
+        } else {
+            char hash[24];
+            std::snprintf(hash, sizeof(hash), "#%016llx", static_cast<unsigned long long>(key));
+            out << hash;
+        }
+        out << '\t' << audit::decisionName(record.decision) << '\n';
+    }
+    if ((file.size() - sizeof(header)) % sizeof(audit::Record) != 0) {
+        std::cerr << "Последняя запись аудита обрезана и пропущена\n";
+    }
+}
+
+// Ошибка в записи загружаемого файла
+struct LoadError {
+    size_t line;   // номер строки файла (с 1)
+    size_t record; // номер пользователя или ресурса в своем разделе (с 1)
+    std::string message;
+};
+
+// Итог массового импорта пользователей
+struct ImportReport {
+    size_t imported = 0;
+    double seconds = 0;
+    double recordsPerSecond = 0;
+    std::vector<LoadError> errors; // record - номер записи без учета заголовка
+};
+
+// Построчное чтение CSV/TSV: разделитель определяется по первой записи
+// (табуляция, точка с запятой или запятая), поля в кавычках могут содержать
+// разделители, переводы строк и удвоенные кавычки
+class CsvReader {
+private:
+    std::istream& in;
+    std::vector<char> buffer;
+    size_t position = 0;
+    size_t filled = 0;
+    char delimiter = 0;
+    size_t lineNumber = 0;
+    size_t recordLine = 0;
+
+    int peek() {
+        if (position == filled) {
+            in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            filled = static_cast<size_t>(in.gcount());
+            position = 0;
+            if (filled == 0) return EOF;
+        }
+        return static_cast<unsigned char>(buffer[position]);
+    }
+
+    void detectDelimiter() {
+        // Просматриваем начало потока до конца первой строки, не расходуя его
+        size_t end = position;
+        while (true) {
+            if (end == filled) {
+                if (filled == buffer.size()) break; // строка длиннее буфера
+                in.read(buffer.data() + filled, static_cast<std::streamsize>(buffer.size() - filled));
+                size_t got = static_cast<size_t>(in.gcount());
+                if (got == 0) break;
+                filled += got;
+            }
+            char c = buffer[end];
+            if (c == '\n') break;
+            if (c == '\t') { delimiter = '\t'; return; }
+            ++end;
+        }
+        std::string_view first(buffer.data() + position, end - position);
+        delimiter = first.find(';') != std::string_view::npos && first.find(',') == std::string_view::npos ? ';' : ',';
+    }
+
+public:
+    explicit CsvReader(std::istream& stream) : in(stream), buffer(1 << 16) {}
+
+    char getDelimiter() const { return delimiter; }
+
+    // Номер строки, с которой началась последняя прочитанная запись
+    size_t line() const { return recordLine; }
+
+    bool next(std::vector<std::string>& fields) {
+        if (!delimiter) {
+            if (peek() == EOF) return false;
+            detectDelimiter();
+        }
+        fields.clear();
+        int c = peek();
+        if (c == EOF) return false;
+        recordLine = ++lineNumber;
+        size_t lineBreaks = 0;
+        std::string field;
+        bool quoted = false;
+        while (true) {
+            c = peek();
+            if (c == EOF) break;
+            ++position;
+            if (quoted) {
+                if (c == '"') {
+                    if (peek() == '"') {
+                        ++position;
+                        field += '"';
+                    } else {
+                        quoted = false;
+                    }
+                } else {
+                    if (c == '\n') ++lineBreaks;
+                    field += static_cast<char>(c);
+                }
+            } else if (c == '"' && field.empty()) {
+                quoted = true;
+            } else if (c == delimiter) {
+                fields.push_back(std::move(field));
+                field.clear();
+            } else if (c == '\n') {
+                break;
+            } else if (c != '\r') {
+                field += static_cast<char>(c);
+            }
+        }
+        fields.push_back(std::move(field));
+        lineNumber += lineBreaks;
+        if (quoted) throw InvalidInputException("Строка " + std::to_string(recordLine) + ": незакрытая кавычка");
+        return true;
+    }
+};
+
+// Дисковый справочник: B+-деревья в одном файле со страницами по 4 КБ.
+// Страница 0 - FileHeader, дальше страницы трех деревьев: пользователи по ID,
+// пользователи по имени (значение - ID) и ресурсы по названию. Деревья строятся
+// один раз снизу вверх из отсортированных записей и дальше только читаются;
+// изменения вносятся в AccessControlSystem и сохраняются в новый файл.
+// Страница: PageHeader, массив смещений записей (uint16), записи лежат с конца
+// страницы: uint16 длина ключа, uint16 длина значения, ключ, значение.
+// Ключи сравниваются побайтно, целые ключи записываются в порядке big-endian
+// с инвертированным знаковым битом. Во внутренних страницах значение - номер
+// дочерней страницы (uint32), ключ - первый ключ поддерева.
+namespace btree {
+    const char magic[4] = {'A', 'C', 'S', 'T'};
+    const uint32_t version = 1;
+    const uint32_t pageSize = 4096;
+    const uint32_t byteOrderMark = 0x01020304;
+    const size_t maxEntryBytes = 1024; // в странице помещается не меньше трех записей
+
+    enum class PageKind : uint8_t {
+        Leaf = 1,
+        Inner = 2
+    };
+
+    struct PageHeader {
+        uint8_t kind;
+        uint8_t reserved;
+        uint16_t count;
+        uint32_t next; // следующий лист того же дерева, 0 - последний
+    };
+
+    struct TreeRoot {
+        uint32_t root;
+        uint32_t height; // 1 - корень является листом
+        uint64_t entries;
+    };
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t pageSize;
+        uint32_t byteOrder;
+        uint64_t pageCount;
+        TreeRoot usersById;
+        TreeRoot usersByName;
+        TreeRoot resourcesByName;
+    };
+
+    using Entry = std::pair<std::string, std::string>;
+
+    inline void encodeInt(int32_t value, char out[4]) {
+        uint32_t bits = static_cast<uint32_t>(value) ^ 0x80000000u;
+        for (int i = 0; i < 4; ++i) out[i] = static_cast<char>(bits >> (24 - 8 * i));
+    }
+
+    inline std::string intKey(int32_t value) {
+        char bytes[4];
+        encodeInt(value, bytes);
+        return std::string(bytes, 4);
+    }
+
+    inline int32_t decodeInt(std::string_view key) {
+        uint32_t bits = 0;
+        for (int i = 0; i < 4; ++i) bits = (bits << 8) | static_cast<unsigned char>(key[i]);
+        return static_cast<int32_t>(bits ^ 0x80000000u);
+    }
+
+    // Значение записи пользователя: uint8 тип, uint8 уровень, RoleMask,
+    // uint16 длина имени, имя, атрибут (до конца записи)
+    inline std::string userValue(const User& user) {
+        std::string value(2 + sizeof(RoleMask) + 2, '\0');
+        value[0] = static_cast<char>(user.getKind());
+        value[1] = static_cast<char>(user.getAccessLevel());
+        std::memcpy(&value[2], &user.getCustomRoles(), sizeof(RoleMask));
+        uint16_t nameLength = static_cast<uint16_t>(user.getName().size());
+        std::memcpy(&value[2 + sizeof(RoleMask)], &nameLength, sizeof(nameLength));
+        return value + user.getName() + user.getAttribute();
+    }
+
+    // Значение записи ресурса: uint8 уровень, RoleMask
+    inline std::string resourceValue(int level, const RoleMask& roles) {
+        std::string value(1 + sizeof(RoleMask), '\0');
+        value[0] = static_cast<char>(level);
+        std::memcpy(&value[1], &roles, sizeof(RoleMask));
+        return value;
+    }
+
+    // Все роли из записи пользователя или ресурса (уровень и дополнительные роли)
+    inline RoleMask rolesOf(std::string_view value, size_t levelOffset) {
+        RoleMask roles;
+        std::memcpy(&roles, value.data() + levelOffset + 1, sizeof(RoleMask));
+        return RoleMask::forLevel(static_cast<uint8_t>(value[levelOffset])) | roles;
+    }
+
+    inline std::unique_ptr<User> decodeUser(std::string_view key, std::string_view value) {
+        const size_t fixed = 2 + sizeof(RoleMask) + 2;
+        uint16_t nameLength;
+        if (value.size() < fixed) throw std::runtime_error("Дисковый справочник поврежден");
+        std::memcpy(&nameLength, value.data() + 2 + sizeof(RoleMask), sizeof(nameLength));
+        if (value.size() < fixed + nameLength) throw std::runtime_error("Дисковый справочник поврежден");
+        auto user = makeUser(static_cast<UserKind>(value[0]), std::string(value.substr(fixed, nameLength)),
+                             decodeInt(key), std::string(value.substr(fixed + nameLength)));
+        int level = static_cast<uint8_t>(value[1]);
+        if (user->getAccessLevel() != level) user->setAccessLevel(level);
+        RoleMask roles;
+        std::memcpy(&roles, value.data() + 2, sizeof(RoleMask));
+        user->setCustomRoles(roles);
+        return user;
+    }
+
+    // Чтение страницы без копирования
+    class PageView {
+    private:
+        const char* data;
+
+        uint16_t u16(size_t offset) const {
+            uint16_t value;
+            std::memcpy(&value, data + offset, sizeof(value));
+            return value;
+        }
+
+    public:
+        explicit PageView(const char* page) : data(page) {}
+
+        PageHeader header() const {
+            PageHeader h;
+            std::memcpy(&h, data, sizeof(h));
+            return h;
+        }
+
+        size_t count() const { return header().count; }
+        size_t entryOffset(size_t i) const { return u16(sizeof(PageHeader) + i * 2); }
+        std::string_view key(size_t i) const {
+            size_t offset = entryOffset(i);
+            return std::string_view(data + offset + 4, u16(offset));
+        }
+        std::string_view value(size_t i) const {
+            size_t offset = entryOffset(i);
+            return std::string_view(data + offset + 4 + u16(offset), u16(offset + 2));
+        }
+        uint32_t child(size_t i) const {
+            uint32_t page;
+            std::memcpy(&page, value(i).data(), sizeof(page));
+            return page;
+        }
+
+        // Первая запись с ключом не меньше key
+        size_t lowerBound(std::string_view key) const {
+            size_t low = 0, high = count();
+            while (low < high) {
+                size_t middle = (low + high) / 2;
+                if (this->key(middle) < key) low = middle + 1;
+                else high = middle;
+            }
+            return low;
+        }
+
+        // Поддерево, в котором может начинаться диапазон ключей не меньше key:
+        // последнее, первый ключ которого меньше key (или самое первое)
+        size_t childFor(std::string_view key) const {
+            size_t position = lowerBound(key);
+            return position == 0 ? 0 : position - 1;
+        }
+
+        // Проверка структуры страницы, прочитанной с диска
+        bool valid() const {
+            PageHeader h = header();
+            if (h.kind != static_cast<uint8_t>(PageKind::Leaf) && h.kind != static_cast<uint8_t>(PageKind::Inner)) {
+                return false;
+            }
+            size_t entriesStart = sizeof(PageHeader) + h.count * 2;
+            if (entriesStart > pageSize) return false;
+            for (size_t i = 0; i < h.count; ++i) {
+                size_t offset = entryOffset(i);
+                if (offset < entriesStart || offset + 4 > pageSize) return false;
+                if (offset + 4 + u16(offset) + u16(offset + 2) > pageSize) return false;
+                if (h.kind == static_cast<uint8_t>(PageKind::Inner) && u16(offset + 2) != sizeof(uint32_t)) return false;
+            }
+            return true;
+        }
+    };
+
+    // Заполнение одной страницы записями
+    class PageBuilder {
+    private:
+        std::vector<char> page;
+        size_t count = 0;
+        size_t freeEnd = pageSize;
+
+    public:
+        explicit PageBuilder(PageKind kind) : page(pageSize, 0) { page[0] = static_cast<char>(kind); }
+
+        size_t size() const { return count; }
+
+        bool add(std::string_view key, std::string_view value) {
+            size_t bytes = 4 + key.size() + value.size();
+            if (sizeof(PageHeader) + (count + 1) * 2 + bytes > freeEnd) return false;
+            freeEnd -= bytes;
+            uint16_t lengths[2] = {static_cast<uint16_t>(key.size()), static_cast<uint16_t>(value.size())};
+            std::memcpy(&page[freeEnd], lengths, sizeof(lengths));
+            std::memcpy(&page[freeEnd + 4], key.data(), key.size());
+            std::memcpy(&page[freeEnd + 4 + key.size()], value.data(), value.size());
+            uint16_t offset = static_cast<uint16_t>(freeEnd);
+            std::memcpy(&page[sizeof(PageHeader) + count * 2], &offset, sizeof(offset));
+            ++count;
+            return true;
+        }
+
+        const char* finish(uint32_t next) {
+            uint16_t entries = static_cast<uint16_t>(count);
+            std::memcpy(&page[2], &entries, sizeof(entries));
+            std::memcpy(&page[4], &next, sizeof(next));
+            return page.data();
+        }
+
+        void reset() {
+            std::fill(page.begin() + 1, page.end(), 0);
+            count = 0;
+            freeEnd = pageSize;
+        }
+    };
+
+    // Запись файла справочника: деревья строятся из уже отсортированных записей
+    class FileWriter {
+    private:
+        std::ofstream out;
+        uint32_t nextPage = 1;
+
+        uint32_t writePage(const char* page) {
+            out.write(page, pageSize);
+            if (!out) throw std::runtime_error("Ошибка записи дискового справочника");
+            return nextPage++;
+        }
+
+    public:
+        explicit FileWriter(const std::string& filename) : out(filename, std::ios::binary | std::ios::trunc) {
+            if (!out) throw std::runtime_error("Не удалось открыть файл для записи");
+            std::vector<char> placeholder(pageSize, 0);
+            out.write(placeholder.data(), pageSize);
+        }
+
+        TreeRoot writeTree(const std::vector<Entry>& entries) {
+            TreeRoot tree = {0, 1, entries.size()};
+            std::vector<std::pair<std::string, uint32_t>> level; // первый ключ и номер страницы
+            PageBuilder leaf(PageKind::Leaf);
+            std::string firstKey;
+            for (const auto& entry : entries) {
+                if (4 + entry.first.size() + entry.second.size() > maxEntryBytes) {
+                    throw InvalidInputException("Слишком длинная запись для дискового справочника");
+                }
+                if (!leaf.add(entry.first, entry.second)) {
+                    level.emplace_back(std::move(firstKey), writePage(leaf.finish(nextPage + 1)));
+                    leaf.reset();
+                    leaf.add(entry.first, entry.second);
+                }
+                if (leaf.size() == 1) firstKey = entry.first;
+            }
+            level.emplace_back(std::move(firstKey), writePage(leaf.finish(0)));
+
+            while (level.size() > 1) {
+                std::vector<std::pair<std::string, uint32_t>> parents;
+                PageBuilder inner(PageKind::Inner);
+                std::string parentKey;
+                for (const auto& child : level) {
+                    char page[sizeof(uint32_t)];
+                    std::memcpy(page, &child.second, sizeof(page));
+                    std::string_view value(page, sizeof(page));
+                    if (!inner.add(child.first, value)) {
+                        parents.emplace_back(std::move(parentKey), writePage(inner.finish(0)));
+                        inner.reset();
+                        inner.add(child.first, value);
+                    }
+                    if (inner.size() == 1) parentKey = child.first;
+                }
+                parents.emplace_back(std::move(parentKey), writePage(inner.finish(0)));
+                level = std::move(parents);
+                ++tree.height;
+            }
+            tree.root = level[0].second;
+            return tree;
+        }
+
+        void finish(FileHeader header) {
+            std::memcpy(header.magic, magic, sizeof(header.magic));
+            header.version = version;
+            header.pageSize = pageSize;
+            header.byteOrder = byteOrderMark;
+            header.pageCount = nextPage;
+            std::vector<char> page(pageSize, 0);
+            std::memcpy(page.data(), &header, sizeof(header));
+            out.seekp(0);
+            out.write(page.data(), pageSize);
+            if (!out.flush()) throw std::runtime_error("Ошибка записи дискового справочника");
+        }
+    };
+}
+
+// Пул буферов страниц фиксированного размера с вытеснением по алгоритму CLOCK.
+// Страница закрепляется на время чтения (Pin) и не вытесняется, пока закреплена.
+// Промахи читают страницу через pread под мьютексом пула.
+class BufferPool {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;    // прочитано страниц с диска
+        uint64_t evictions = 0;
+        size_t frames = 0;
+    };
+
+private:
+    struct Frame {
+        uint32_t page = 0; // 0 - кадр свободен (страница 0 - заголовок, в пул не попадает)
+        uint32_t pins = 0;
+        bool referenced = false;
+    };
+
+    int fd;
+    std::vector<char> memory;
+    std::vector<Frame> frames;
+    std::unordered_map<uint32_t, uint32_t> table; // страница -> кадр
+    size_t hand = 0;
+    mutable std::mutex mutex;
+    Stats stats;
+
+    void unpin(uint32_t frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        --frames[frame].pins;
+    }
+
+    uint32_t takeFrame() {
+        for (size_t scanned = 0; scanned < frames.size() * 2; ++scanned) {
+            Frame& f = frames[hand];
+            uint32_t index = static_cast<uint32_t>(hand);
+            hand = (hand + 1) % frames.size();
+            if (f.pins > 0) continue;
+            if (f.page == 0) return index;
+            if (f.referenced) {
+                f.referenced = false;
+                continue;
+            }
+            table.erase(f.page);
+            f.page = 0;
+            ++stats.evictions;
+            return index;
+        }
+        throw std::runtime_error("Все страницы пула буферов закреплены");
+    }
+
+public:
+    // Закрепленная страница; открепляется в деструкторе
+    class Pin {
+    private:
+        BufferPool* pool;
+        uint32_t frame;
+
+    public:
+        Pin(BufferPool* p, uint32_t f) : pool(p), frame(f) {}
+        Pin(Pin&& other) noexcept : pool(other.pool), frame(other.frame) { other.pool = nullptr; }
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        Pin& operator=(Pin&&) = delete;
+        ~Pin() {
+            if (pool) pool->unpin(frame);
+        }
+
+        const char* data() const { return pool->memory.data() + size_t(frame) * btree::pageSize; }
+    };
+
+    BufferPool(int file, size_t frameCount)
+        : fd(file), memory(frameCount * btree::pageSize), frames(frameCount) {
+        stats.frames = frameCount;
+        table.reserve(frameCount);
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    Pin fetch(uint32_t page) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = table.find(page);
+        if (it != table.end()) {
+            Frame& f = frames[it->second];
+            ++f.pins;
+            f.referenced = true;
+            ++stats.hits;
+            return Pin(this, it->second);
+        }
+        uint32_t index = takeFrame();
+        char* target = memory.data() + size_t(index) * btree::pageSize;
+        ssize_t bytesRead = ::pread(fd, target, btree::pageSize, off_t(page) * btree::pageSize);
+        if (bytesRead != static_cast<ssize_t>(btree::pageSize) || !btree::PageView(target).valid()) {
+            throw std::runtime_error("Не удалось прочитать страницу дискового справочника");
+        }
+        Frame& f = frames[index];
+        f.page = page;
+        f.pins = 1;
+        f.referenced = false;
+        table.emplace(page, index);
+        ++stats.misses;
+        return Pin(this, index);
+    }
+
+    // Освобождает все незакрепленные кадры (для замеров с холодным кэшем)
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Frame& f : frames) {
+            if (f.pins > 0 || f.page == 0) continue;
+            table.erase(f.page);
+            f.page = 0;
+            f.referenced = false;
+        }
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+};
+
+// Справочник пользователей и ресурсов, который читается с диска через пул
+// буферов заданного размера (см. namespace btree). Файл записывает
+// AccessControlSystem::saveDiskDirectory. Память не зависит от размера
+// справочника: поиск по ID или названию читает не больше height страниц
+// каждого дерева. Методы можно вызывать из нескольких потоков.
+class DiskDirectory {
+private:
+    int fd = -1;
+    btree::FileHeader header;
+    std::unique_ptr<BufferPool> pool;
+    std::unique_ptr<BloomFilter> userFilter;     // nullptr - фильтры выключены
+    std::unique_ptr<BloomFilter> resourceFilter;
+
+    // Фильтр по всем ключам дерева: листья читаются подряд в обход пула буферов
+    template<typename Hash>
+    std::unique_ptr<BloomFilter> buildFilter(const btree::TreeRoot& tree, double rate, Hash hash) const {
+        auto filter = std::make_unique<BloomFilter>(tree.entries, rate);
+        std::vector<char> page(btree::pageSize);
+        auto readPage = [&](uint32_t number) {
+            if (::pread(fd, page.data(), btree::pageSize, off_t(number) * btree::pageSize) !=
+                    static_cast<ssize_t>(btree::pageSize) || !btree::PageView(page.data()).valid()) {
+                throw std::runtime_error("Не удалось прочитать страницу дискового справочника");
+            }
+            return btree::PageView(page.data());
+        };
+        uint32_t number = tree.root;
+        for (uint32_t level = tree.height; level > 1; --level) {
+            btree::PageView view = readPage(number);
+            if (view.count() == 0) throw std::runtime_error("Дисковый справочник поврежден");
+            number = view.child(0);
+        }
+        while (number != 0) {
+            btree::PageView view = readPage(number);
+            for (size_t i = 0; i < view.count(); ++i) filter->add(hash(view.key(i)));
+            number = view.header().next;
+        }
+        return filter;
+    }
+
+    // Вызывает fn(ключ, значение) для записей с ключом не меньше key по
+    // возрастанию, пока fn возвращает true. Страница записи закреплена на время вызова.
+    template<typename Fn>
+    void scanFrom(const btree::TreeRoot& tree, std::string_view key, Fn fn) const {
+        uint32_t page = tree.root;
+        for (uint32_t level = tree.height; level > 1; --level) {
+            BufferPool::Pin pin = pool->fetch(page);
+            btree::PageView view(pin.data());
+            if (view.header().kind != static_cast<uint8_t>(btree::PageKind::Inner) || view.count() == 0) {
+                throw std::runtime_error("Дисковый справочник поврежден");
+            }
+            page = view.child(view.childFor(key));
+        }
+        size_t position = SIZE_MAX;
+        while (page != 0) {
+            BufferPool::Pin pin = pool->fetch(page);
+            btree::PageView view(pin.data());
+            if (view.header().kind != static_cast<uint8_t>(btree::PageKind::Leaf)) {
+                throw std::runtime_error("Дисковый справочник поврежден");
+            }
+            if (position == SIZE_MAX) position = view.lowerBound(key);
+            for (; position < view.count(); ++position) {
+                if (!fn(view.key(position), view.value(position))) return;
+            }
+            position = 0;
+            page = view.header().next;
+        }
+    }
+
+    // Вызывает fn(значение) для записи с ключом key; false, если записи нет
+    template<typename Fn>
+    bool findExact(const btree::TreeRoot& tree, std::string_view key, Fn fn) const {
+        bool found = false;
+        scanFrom(tree, key, [&](std::string_view k, std::string_view value) {
+            if (k == key) {
+                fn(value);
+                found = true;
+            }
+            return false;
+        });
+        return found;
+    }
+
+    bool userRoles(int userId, RoleMask& roles) const {
+        if (userFilter && !userFilter->mayContain(BloomFilter::hash(userId))) return false;
+        char key[4];
+        btree::encodeInt(userId, key);
+        bool found = findExact(header.usersById, std::string_view(key, 4),
+                               [&](std::string_view value) { roles = btree::rolesOf(value, 1); });
+        if (!found && userFilter) userFilter->noteFalsePositive();
+        return found;
+    }
+
+    bool resourceRoles(const std::string& name, RoleMask& roles) const {
+        if (resourceFilter && !resourceFilter->mayContain(BloomFilter::hash(name))) return false;
+        bool found = findExact(header.resourcesByName, name,
+                               [&](std::string_view value) { roles = btree::rolesOf(value, 0); });
+        if (!found && resourceFilter) resourceFilter->noteFalsePositive();
+        return found;
+    }
+
+public:
+    // cacheBytes - размер пула буферов (не меньше 16 страниц). Если задана доля
+    // ложных срабатываний bloomFalsePositiveRate, при открытии по ключам строятся
+    // фильтры Блума и decideAccess отсеивает неизвестные ID и названия без чтения страниц.
+    explicit DiskDirectory(const std::string& filename, size_t cacheBytes = size_t(64) << 20,
+                           double bloomFalsePositiveRate = 0) {
+        fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Не удалось открыть файл для чтения");
+        try {
+            if (::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+                throw std::runtime_error("Дисковый справочник поврежден");
+            }
+            if (std::memcmp(header.magic, btree::magic, sizeof(header.magic)) != 0) {
+                throw std::runtime_error("Файл не является дисковым справочником");
+            }
+            if (header.version != btree::version || header.pageSize != btree::pageSize ||
+                header.byteOrder != btree::byteOrderMark) {
+                throw std::runtime_error("Неподдерживаемая версия дискового справочника");
+            }
+            struct stat info;
+            if (::fstat(fd, &info) != 0 || uint64_t(info.st_size) < header.pageCount * btree::pageSize) {
+                throw std::runtime_error("Дисковый справочник поврежден");
+            }
+            pool = std::make_unique<BufferPool>(fd, std::max<size_t>(16, cacheBytes / btree::pageSize));
+            if (bloomFalsePositiveRate > 0) {
+                userFilter = buildFilter(header.usersById, bloomFalsePositiveRate,
+                                         [](std::string_view key) { return BloomFilter::hash(btree::decodeInt(key)); });
+                resourceFilter = buildFilter(header.resourcesByName, bloomFalsePositiveRate,
+                                             [](std::string_view key) { return BloomFilter::hash(key); });
+            }
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    DiskDirectory(const DiskDirectory&) = delete;
+    DiskDirectory& operator=(const DiskDirectory&) = delete;
+
+    ~DiskDirectory() { ::close(fd); }
+
+    size_t userCount() const { return header.usersById.entries; }
+    size_t resourceCount() const { return header.resourcesByName.entries; }
+    uint64_t fileBytes() const { return header.pageCount * btree::pageSize; }
+    BufferPool::Stats cacheStats() const { return pool->getStats(); }
+
+    BloomFilter::Stats userFilterStats() const {
+        return userFilter ? userFilter->getStats() : BloomFilter::Stats();
+    }
+
+    BloomFilter::Stats resourceFilterStats() const {
+        return resourceFilter ? resourceFilter->getStats() : BloomFilter::Stats();
+    }
+
+    // Сбрасывает пул буферов и просит ОС выбросить файл из страничного кэша
+    void dropCaches() {
+        pool->clear();
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    // Как AccessControlSystem::decideAccess, но без кэша решений и аудита.
+    // Ошибки чтения файла сообщаются исключением.
+    AccessDecision decideAccess(int userId, const std::string& resourceName) const {
+        RoleMask held, required;
+        if (!userRoles(userId, held)) return AccessDecision::UnknownUser;
+        if (!resourceRoles(resourceName, required)) return AccessDecision::UnknownResource;
+        return held.covers(required) ? AccessDecision::Allowed : AccessDecision::Denied;
+    }
+
+    bool checkAccess(int userId, const std::string& resourceName) const {
+        switch (decideAccess(userId, resourceName)) {
+            case AccessDecision::Allowed:
+                return true;
+            case AccessDecision::UnknownUser:
+                throw std::runtime_error("Пользователь с ID " + std::to_string(userId) + " не найден");
+            case AccessDecision::UnknownResource:
+                throw std::runtime_error("Ресурс с именем " + resourceName + " не найден");
+            case AccessDecision::Denied:
+                break;
+        }
+        throw AccessDeniedException("Доступ запрещен для пользователя " + getUser(userId)->getName() +
+                                    " к ресурсу " + resourceName);
+    }
+
+    // Копия пользователя из файла или nullptr
+    std::unique_ptr<User> getUser(int id) const {
+        std::unique_ptr<User> user;
+        std::string key = btree::intKey(id);
+        findExact(header.usersById, key, [&](std::string_view value) { user = btree::decodeUser(key, value); });
+        return user;
+    }
+
+    std::unique_ptr<Resource> getResource(const std::string& name) const {
+        std::unique_ptr<Resource> resource;
+        findExact(header.resourcesByName, name, [&](std::string_view value) {
+            resource = std::make_unique<Resource>(name, static_cast<uint8_t>(value[0]));
+            RoleMask roles;
+            std::memcpy(&roles, value.data() + 1, sizeof(RoleMask));
+            resource->setCustomRoles(roles);
+        });
+        return resource;
+    }
+
+    // Пользователи с точно таким именем (не больше limit), по возрастанию ID
+    std::vector<std::unique_ptr<User>> findUsersByName(const std::string& name, size_t limit = SIZE_MAX) const {
+        std::vector<int> ids;
+        if (limit == 0) return {};
+        scanFrom(header.usersByName, name, [&](std::string_view key, std::string_view value) {
+            if (key != name) return false;
+            ids.push_back(btree::decodeInt(value));
+            return ids.size() < limit;
+        });
+        std::vector<std::unique_ptr<User>> found;
+        for (int id : ids) {
+            auto user = getUser(id);
+            if (user) found.push_back(std::move(user));
+        }
+        return found;
+    }
+
+    void findUserByName(const std::string& name) const {
+        auto found = findUsersByName(name);
+        for (const auto& user : found) user->displayInfo();
+        if (found.empty()) {
+            std::cout << "Пользователь с именем " << name << " не найден" << std::endl;
+        }
+    }
+
+    void findUserById(int id) const {
+        auto user = getUser(id);
+        if (user) {
+            user->displayInfo();
+        } else {
+            std::cout << "Пользователь с ID " << id << " не найден" << std::endl;
+        }
+    }
+};
+
+// Запрос для пакетной проверки доступа
+struct AccessQuery {
+    int userId;
+    std::string resourceName;
+};
+
+// Шаблонный класс системы контроля доступа
+// Пользователи индексируются по ID, ресурсы - по названию, поэтому проверка доступа
+// не зависит от размера справочника. Индексы обновляются через UserObserver/ResourceObserver.
+template<typename T>
+class AccessControlSystem : public UserObserver, public ResourceObserver {
+private:
+    std::vector<std::unique_ptr<User>> users;
+    std::vector<T> resources;
+    std::unordered_map<int, User*> usersById;
+    std::unordered_map<std::string, size_t> resourcesByName; // индекс в resources
+    std::vector<RoleMask> resourceRoles; // требуемые роли resources[i] подряд для reachableResources
+    NameIndex namesIndex;
+    SortedUserView<NameOrderKey> nameView;
+    SortedUserView<AccessLevelOrderKey> accessLevelView;
+    std::unique_ptr<WorkerPool> workerPool; // для пакетной проверки, nullptr - один поток
+    std::unique_ptr<DecisionCache> decisionCache; // nullptr - кэш выключен
+    mutable std::mutex cacheMutex;
+    std::unique_ptr<BloomFilter> userFilter;     // ID пользователей, nullptr - фильтры выключены
+    std::unique_ptr<BloomFilter> resourceFilter; // названия ресурсов
+    double bloomFalsePositiveRate = 0;
+    std::unique_ptr<Journal> changeJournal; // nullptr - журнал не ведется
+    std::shared_ptr<AuditTrail> auditTrail; // nullptr - аудит выключен; общий с копиями clone()
+    std::string journalSnapshotFile;
+    uint32_t journalGeneration = 0;
+    bool journalPaused = false;
+
+    void journalRecord(journal::RecordWriter record) {
+        if (!changeJournal || journalPaused) return;
+        changeJournal->append(record.finish());
+    }
+
+    // Сжатие запускается из методов верхнего уровня, а не из уведомлений
+    // наблюдателя: там изменение поля еще не применено
+    void compactJournalIfNeeded() {
+        if (!changeJournal || journalPaused) return;
+        uint64_t limit = changeJournal->getOptions().compactAfterBytes;
+        if (limit > 0 && changeJournal->size() >= limit) compactJournal();
+    }
+
+    // Пока объект жив, изменения не попадают в журнал (загрузка, воспроизведение)
+    class JournalPause {
+    private:
+        bool& flag;
+        bool previous;
+    public:
+        explicit JournalPause(bool& f) : flag(f), previous(f) { flag = true; }
+        ~JournalPause() { flag = previous; }
+        bool wasPaused() const { return previous; }
+    };
+
+    void applyJournalRecord(journal::RecordType type, journal::RecordReader& in) {
+        auto requireUser = [this](int id) {
+            User* user = getUser(id);
+            if (!user) throw std::runtime_error("Журнал не соответствует снимку: нет пользователя " + std::to_string(id));
+            return user;
+        };
+        auto requireResource = [this](const std::string& name) {
+            T* resource = getResource(name);
+            if (!resource) throw std::runtime_error("Журнал не соответствует снимку: нет ресурса " + name);
+            return resource;
+        };
+        using journal::RecordType;
+        switch (type) {
+            case RecordType::Header:
+                break;
+            case RecordType::AddUser: {
+                UserKind kind = static_cast<UserKind>(in.u8());
+                int id = in.i32();
+                int level = in.u8();
+                std::string name = in.str();
+                auto user = makeUser(kind, name, id, in.str());
+                if (user->getAccessLevel() != level) user->setAccessLevel(level);
+                addUser(std::move(user));
+                break;
+            }
+            case RecordType::RemoveUser:
+                removeUser(in.i32());
+                break;
+            case RecordType::SetUserId: {
+                User* user = requireUser(in.i32());
+                user->setId(in.i32());
+                break;
+            }
+            case RecordType::SetUserName: {
+                User* user = requireUser(in.i32());
+                user->setName(in.str());
+                break;
+            }
+            case RecordType::SetUserAccessLevel: {
+                User* user = requireUser(in.i32());
+                user->setAccessLevel(in.u8());
+                break;
+            }
+            case RecordType::SetUserAttribute: {
+                User* user = requireUser(in.i32());
+                user->setAttribute(in.str());
+                break;
+            }
+            case RecordType::AddResource: {
+                int level = in.u8();
+                addResource(T(in.str(), level));
+                break;
+            }
+            case RecordType::SetResourceName: {
+                T* resource = requireResource(in.str());
+                resource->setName(in.str());
+                break;
+            }
+            case RecordType::SetResourceAccessLevel: {
+                T* resource = requireResource(in.str());
+                resource->setRequiredAccessLevel(in.u8());
+                break;
+            }
+            case RecordType::SortByName:
+                sortUsersByName();
+                break;
+            case RecordType::SortByAccessLevel:
+                sortUsersByAccessLevel();
+                break;
+            case RecordType::SetUserRoles: {
+                User* user = requireUser(in.i32());
+                user->setCustomRoles(in.roles());
+                break;
+            }
+            case RecordType::SetResourceRoles: {
+                T* resource = requireResource(in.str());
+                resource->setCustomRoles(in.roles());
+                break;
+            }
+            default:
+                throw std::runtime_error("Неизвестный тип записи журнала");
+        }
+    }
+
+    AccessDecision evaluateAccess(int userId, const std::string& resourceName) const noexcept {
+        const User* user = getUser(userId);
+        if (!user) {
+            if (userFilter) userFilter->noteFalsePositive();
+            return AccessDecision::UnknownUser;
+        }
+        const T* resource = getResource(resourceName);
+        if (!resource) {
+            if (resourceFilter) resourceFilter->noteFalsePositive();
+            return AccessDecision::UnknownResource;
+        }
+        return resource->checkAccess(*user) ? AccessDecision::Allowed : AccessDecision::Denied;
+    }
+
+    void invalidateUser(int userId) {
+        if (!decisionCache) return;
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        decisionCache->invalidateUser(userId);
+    }
+
+    void invalidateResource(const std::string& name) {
+        if (!decisionCache) return;
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        decisionCache->invalidateResource(name);
+    }
+
+    // Заменяет содержимое системы. Индексы строятся отдельно и подменяются
+    // только если в новых данных нет повторяющихся ID и названий.
+    void replaceContents(std::vector<std::unique_ptr<User>> newUsers, std::vector<T> newResources) {
+        std::unordered_map<int, User*> newUsersById;
+        newUsersById.reserve(newUsers.size());
+        for (const auto& user : newUsers) {
+            if (!newUsersById.emplace(user->getId(), user.get()).second) {
+                throw InvalidInputException("Пользователь с ID " + std::to_string(user->getId()) + " уже существует");
+            }
+        }
+        std::unordered_map<std::string, size_t> newResourcesByName;
+        newResourcesByName.reserve(newResources.size());
+        for (size_t i = 0; i < newResources.size(); ++i) {
+            if (!newResourcesByName.emplace(newResources[i].getName(), i).second) {
+                throw InvalidInputException("Ресурс с именем " + newResources[i].getName() + " уже существует");
+            }
+        }
+
+        clear();
+        users = std::move(newUsers);
+        resources = std::move(newResources);
+        usersById = std::move(newUsersById);
+        resourcesByName = std::move(newResourcesByName);
+        for (auto& user : users) {
+            user->setObserver(this);
+            namesIndex.add(user.get(), user->getName());
+            nameView.insert(user.get());
+            accessLevelView.insert(user.get());
+        }
+        resourceRoles.clear();
+        resourceRoles.reserve(resources.size());
+        for (auto& resource : resources) {
+            resource.setObserver(this);
+            resourceRoles.push_back(resource.getRequiredRoles());
+        }
+        rebuildBloomFilters();
+    }
+
+    // Переставляет основной список в порядке представления без сравнений
+    template<typename View>
+    void reorderUsers(const View& view) {
+        std::vector<std::unique_ptr<User>> ordered;
+        ordered.reserve(users.size());
+        for (auto& user : users) user.release();
+        view.forEach([&ordered](User* user) { ordered.emplace_back(user); });
+        users = std::move(ordered);
+    }
+
+    template<typename Fn>
+    void forEachReachable(const RoleMask& roles, Fn fn) const {
+        const RoleMask* required = resourceRoles.data();
+        const size_t count = resourceRoles.size();
+#ifdef __SSE2__
+        const __m128i held = _mm_loadu_si128(reinterpret_cast<const __m128i*>(roles.words));
+        const __m128i zero = _mm_setzero_si128();
+        for (size_t i = 0; i < count; ++i) {
+            // Недостающие роли: required & ~held
+            __m128i missing = _mm_andnot_si128(held, _mm_loadu_si128(reinterpret_cast<const __m128i*>(required[i].words)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(missing, zero)) == 0xFFFF) fn(i);
+        }
+#else
+        for (size_t i = 0; i < count; ++i) {
+            if (roles.covers(required[i])) fn(i);
+        }
+#endif
+    }
+
+    AccessDecision decideAccessUnaudited(int userId, const std::string& resourceName) const noexcept {
+        if (userFilter) {
+            AccessDecision rejected;
+            if (rejectedByFilters(userId, resourceName, rejected)) return rejected;
+        }
+        if (!decisionCache) return evaluateAccess(userId, resourceName);
+
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        AccessDecision decision;
+        if (decisionCache->lookup(userId, resourceName, decision)) return decision;
+        decision = evaluateAccess(userId, resourceName);
+        try {
+            decisionCache->insert(userId, resourceName, decision);
+        } catch (...) {
+            decisionCache->clear(); // при нехватке памяти просто не кэшируем
+        }
+        return decision;
+    }
+
+    // Отказ по фильтрам Блума без поиска в индексах и кэше. Если отсеян только
+    // ресурс, пользователь все же ищется: неизвестный пользователь важнее.
+    // Прошедшие фильтр, но не найденные ключи учитываются как ложные срабатывания.
+    bool rejectedByFilters(int userId, const std::string& resourceName, AccessDecision& decision) const noexcept {
+        if (!userFilter->mayContain(BloomFilter::hash(userId))) {
+            decision = AccessDecision::UnknownUser;
+            return true;
+        }
+        if (!resourceFilter->mayContain(BloomFilter::hash(resourceName))) {
+            decision = getUser(userId) ? AccessDecision::UnknownResource : AccessDecision::UnknownUser;
+            if (decision == AccessDecision::UnknownUser) userFilter->noteFalsePositive();
+            return true;
+        }
+        return false;
+    }
+
+    // Фильтры строятся с запасом в два раза, чтобы добавления не перестраивали их сразу
+    void rebuildBloomFilters() {
+        if (bloomFalsePositiveRate <= 0) {
+            userFilter.reset();
+            resourceFilter.reset();
+            return;
+        }
+        auto users = std::make_unique<BloomFilter>(usersById.size() * 2, bloomFalsePositiveRate);
+        for (const auto& entry : usersById) users->add(BloomFilter::hash(entry.first));
+        auto names = std::make_unique<BloomFilter>(resourcesByName.size() * 2, bloomFalsePositiveRate);
+        for (const auto& entry : resourcesByName) names->add(BloomFilter::hash(entry.first));
+        if (userFilter) users->shareCounters(*userFilter);
+        if (resourceFilter) names->shareCounters(*resourceFilter);
+        userFilter = std::move(users);
+        resourceFilter = std::move(names);
+    }
+
+    void addToUserFilter(int id) {
+        if (!userFilter) return;
+        userFilter->add(BloomFilter::hash(id));
+        if (userFilter->full()) rebuildBloomFilters();
+    }
+
+    void addToResourceFilter(const std::string& name) {
+        if (!resourceFilter) return;
+        resourceFilter->add(BloomFilter::hash(name));
+        if (resourceFilter->full()) rebuildBloomFilters();
+    }
+
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn,
+                     size_t minChunk = 1024) const {
+        if (workerPool) {
+            workerPool->parallelFor(count, minChunk, fn);
+        } else {
+            fn(0, count);
+        }
+    }
+
+public:
+    AccessControlSystem() {}
+    // Пользователи и ресурсы хранят указатель на систему, поэтому копировать её нельзя
+    AccessControlSystem(const AccessControlSystem&) = delete;
+    AccessControlSystem& operator=(const AccessControlSystem&) = delete;
+
+    ~AccessControlSystem() {
+        for (auto& user : users) user->setObserver(nullptr);
+    }
+
+    void addUser(std::unique_ptr<User> user) {
+        if (!user) throw InvalidInputException("Пользователь не задан");
+        int id = user->getId();
+        if (usersById.count(id)) {
+            throw InvalidInputException("Пользователь с ID " + std::to_string(id) + " уже существует");
+        }
+        user->setObserver(this);
+        usersById.emplace(id, user.get());
+        namesIndex.add(user.get(), user->getName());
+        nameView.insert(user.get());
+        accessLevelView.insert(user.get());
+        const User& added = *user;
+        users.push_back(std::move(user));
+        addToUserFilter(id);
+        invalidateUser(id); // могли быть закэшированы отказы "пользователь не найден"
+        journalRecord(journal::RecordWriter(journal::RecordType::AddUser)
+                          .u8(static_cast<uint8_t>(added.getKind())).i32(id)
+                          .u8(static_cast<uint8_t>(added.getAccessLevel()))
+                          .str(added.getName()).str(added.getAttribute()));
+        if (added.getCustomRoles() != RoleMask()) {
+            journalRecord(journal::RecordWriter(journal::RecordType::SetUserRoles).i32(id).roles(added.getCustomRoles()));
+        }
+        compactJournalIfNeeded();
+    }
+
+    void addResource(const T& resource) {
+        std::string name = resource.getName();
+        if (resourcesByName.count(name)) {
+            throw InvalidInputException("Ресурс с именем " + name + " уже существует");
+        }
+        resources.push_back(resource);
+        try {
+            resourceRoles.push_back(resource.getRequiredRoles());
+        } catch (...) {
+            resources.pop_back();
+            throw;
+        }
+        resources.back().setObserver(this);
+        addToResourceFilter(name);
+        invalidateResource(name);
+        journalRecord(journal::RecordWriter(journal::RecordType::AddResource)
+                          .u8(static_cast<uint8_t>(resource.getRequiredAccessLevel())).str(name));
+        if (resource.getCustomRoles() != RoleMask()) {
+            journalRecord(journal::RecordWriter(journal::RecordType::SetResourceRoles)
+                              .str(name).roles(resource.getCustomRoles()));
+        }
+        resourcesByName.emplace(std::move(name), resources.size() - 1);
+        compactJournalIfNeeded();
+    }
+
+    // Массовый импорт пользователей из CSV/TSV с колонками: тип, имя, ID, атрибут.
+    // Тип - Student/Teacher/Administrator или Студент/Преподаватель/Администратор,
+    // первая строка может быть заголовком. Записи проверяются пакетами в пуле
+    // потоков, повторы ID ищутся по хэш-множеству. Пользователи добавляются только
+    // если ошибок нет, иначе система не меняется и в отчете перечислены все ошибки.
+    ImportReport importUsers(std::istream& in, size_t expectedRecords = 0) {
+        const size_t batchSize = 8192;
+        auto start = std::chrono::steady_clock::now();
+        ImportReport report;
+
+        struct Row {
+            size_t line;
+            std::vector<std::string> fields;
+        };
+        std::vector<std::unique_ptr<User>> imported;
+        std::vector<size_t> importedLines;
+        imported.reserve(expectedRecords);
+        importedLines.reserve(expectedRecords);
+        std::vector<Row> batch(batchSize);
+        std::mutex errorsMutex;
+
+        auto validateBatch = [&](size_t count) {
+            size_t base = imported.size();
+            imported.resize(base + count);
+            importedLines.resize(base + count);
+            parallelFor(count, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    const Row& row = batch[i];
+                    size_t record = base + i + 1;
+                    importedLines[base + i] = row.line;
+                    auto fail = [&](const std::string& message) {
+                        std::lock_guard<std::mutex> lock(errorsMutex);
+                        report.errors.push_back({row.line, record, message});
+                    };
+                    if (row.fields.size() != 4) {
+                        fail("Ожидается 4 поля, получено " + std::to_string(row.fields.size()));
+                        continue;
+                    }
+                    UserKind kind;
+                    if (!parseUserKind(row.fields[0], kind)) {
+                        fail("Неизвестный тип пользователя: " + row.fields[0]);
+                        continue;
+                    }
+                    int id = 0;
+                    const std::string& idText = row.fields[2];
+                    auto parsed = std::from_chars(idText.data(), idText.data() + idText.size(), id);
+                    if (idText.empty() || parsed.ec != std::errc() || parsed.ptr != idText.data() + idText.size()) {
+                        fail("Неверный ID пользователя: " + idText);
+                        continue;
+                    }
+                    try {
+                        imported[base + i] = makeUser(kind, row.fields[1], id, row.fields[3]);
+                    } catch (const std::exception& e) {
+                        fail(e.what());
+                    }
+                }
+            }, 256);
+        };
+
+        CsvReader reader(in);
+        size_t pending = 0;
+        bool firstRow = true;
+        while (reader.next(batch[pending].fields)) {
+            batch[pending].line = reader.line();
+            if (firstRow) {
+                firstRow = false;
+                std::string folded = foldName(batch[pending].fields[0]);
+                if (folded == "type" || folded == "тип") continue; // заголовок
+            }
+            if (batch[pending].fields.size() == 1 && batch[pending].fields[0].empty()) continue;
+            if (++pending == batchSize) {
+                validateBatch(pending);
+                pending = 0;
+            }
+        }
+        validateBatch(pending);
+
+        std::unordered_set<int> seenIds;
+        seenIds.reserve(imported.size());
+        for (size_t i = 0; i < imported.size(); ++i) {
+            if (!imported[i]) continue;
+            int id = imported[i]->getId();
+            if (usersById.count(id) || !seenIds.insert(id).second) {
+                report.errors.push_back({importedLines[i], i + 1,
+                                         "Пользователь с ID " + std::to_string(id) + " уже существует"});
+            }
+        }
+        if (!report.errors.empty()) {
+            std::sort(report.errors.begin(), report.errors.end(),
+                      [](const LoadError& a, const LoadError& b) { return a.line < b.line; });
+            return report;
+        }
+
+        users.reserve(users.size() + imported.size());
+        usersById.reserve(usersById.size() + imported.size());
+        for (auto& user : imported) {
+            int id = user->getId();
+            user->setObserver(this);
+            usersById.emplace(id, user.get());
+            namesIndex.add(user.get(), user->getName());
+            nameView.insert(user.get());
+            accessLevelView.insert(user.get());
+            addToUserFilter(id);
+            invalidateUser(id);
+            journalRecord(journal::RecordWriter(journal::RecordType::AddUser)
+                              .u8(static_cast<uint8_t>(user->getKind())).i32(id)
+                              .u8(static_cast<uint8_t>(user->getAccessLevel()))
+                              .str(user->getName()).str(user->getAttribute()));
+            users.push_back(std::move(user));
+        }
+        compactJournalIfNeeded();
+
+        report.imported = imported.size();
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        report.recordsPerSecond = report.seconds > 0 ? report.imported / report.seconds : 0;
+        return report;
+    }
+
+    // Колоночная копия пользователей для сканирований (не обновляется при изменениях)
+    ColumnarUserStore buildColumnarStore() const {
+        ColumnarUserStore store;
+        size_t textBytes = 0;
+        for (const auto& user : users) textBytes += user->getName().size();
+        store.reserve(users.size(), textBytes);
+        for (const auto& user : users) store.append(*user);
+        store.shrinkToFit();
+        return store;
+    }
+
+    // Обход пользователей в порядке основного списка
+    template<typename Fn>
+    void forEachUser(Fn fn) const {
+        for (const auto& user : users) fn(static_cast<const User&>(*user));
+    }
+
+    template<typename Fn>
+    void forEachResource(Fn fn) const {
+        for (const auto& resource : resources) fn(resource);
+    }
+
+    // Удаляет пользователя; возвращает false, если его нет
+    bool removeUser(int id) {
+        auto it = usersById.find(id);
+        if (it == usersById.end()) return false;
+        User* user = it->second;
+        namesIndex.remove(user, user->getName());
+        nameView.erase(user);
+        accessLevelView.erase(user);
+        usersById.erase(it);
+        invalidateUser(id);
+        auto position = std::find_if(users.begin(), users.end(),
+            [user](const std::unique_ptr<User>& u) { return u.get() == user; });
+        users.erase(position);
+        journalRecord(journal::RecordWriter(journal::RecordType::RemoveUser).i32(id));
+        compactJournalIfNeeded();
+        return true;
+    }
+
+    User* getUser(int id) {
+        auto it = usersById.find(id);
+        return it == usersById.end() ? nullptr : it->second;
+    }
+
+    const User* getUser(int id) const {
+        auto it = usersById.find(id);
+        return it == usersById.end() ? nullptr : it->second;
+    }
+
+    T* getResource(const std::string& name) {
+        auto it = resourcesByName.find(name);
+        return it == resourcesByName.end() ? nullptr : &resources[it->second];
+    }
+
+    const T* getResource(const std::string& name) const {
+        auto it = resourcesByName.find(name);
+        return it == resourcesByName.end() ? nullptr : &resources[it->second];
+    }
+
+    size_t userCount() const { return users.size(); }
+    size_t resourceCount() const { return resources.size(); }
+
+    // Независимая копия системы (пул потоков не копируется)
+    std::unique_ptr<AccessControlSystem> clone() const {
+        std::vector<std::unique_ptr<User>> copiedUsers;
+        copiedUsers.reserve(users.size());
+        for (const auto& user : users) copiedUsers.push_back(user->clone());
+        auto copy = emptyCopy();
+        copy->replaceContents(std::move(copiedUsers), resources);
+        return copy;
+    }
+
+    // Пустая система с общими с этой настройками (журнал аудита, фильтры Блума).
+    // Счетчики фильтров общие с этой системой, поэтому не обнуляются при
+    // каждой публикации новой версии в ConcurrentAccessControlSystem.
+    std::unique_ptr<AccessControlSystem> emptyCopy() const {
+        auto copy = std::make_unique<AccessControlSystem>();
+        copy->auditTrail = auditTrail;
+        copy->setBloomFilters(bloomFalsePositiveRate);
+        if (userFilter && copy->userFilter) copy->userFilter->shareCounters(*userFilter);
+        if (resourceFilter && copy->resourceFilter) copy->resourceFilter->shareCounters(*resourceFilter);
+        return copy;
+    }
+
+    void userIdChanging(const User& user, int newId) override {
+        auto it = usersById.find(user.getId());
+        if (it == usersById.end() || it->second != &user) return; // объект не из этой системы
+        if (usersById.count(newId)) {
+            throw InvalidInputException("Пользователь с ID " + std::to_string(newId) + " уже существует");
+        }
+        User* stored = it->second;
+        usersById.erase(it);
+        usersById.emplace(newId, stored);
+        addToUserFilter(newId);
+        invalidateUser(user.getId());
+        invalidateUser(newId);
+
+        // ID участвует в ключах представлений
+        nameView.erase(stored);
+        accessLevelView.erase(stored);
+        NameOrderKey nameKey(*stored);
+        AccessLevelOrderKey levelKey(*stored);
+        nameKey.id = levelKey.id = newId;
+        nameView.insertKey(std::move(nameKey));
+        accessLevelView.insertKey(levelKey);
+        journalRecord(journal::RecordWriter(journal::RecordType::SetUserId).i32(user.getId()).i32(newId));
+    }
+
+    void userNameChanging(const User& user, const std::string& newName) override {
+        auto it = usersById.find(user.getId());
+        if (it == usersById.end() || it->second != &user) return;
+        namesIndex.add(it->second, newName);
+        namesIndex.remove(&user, user.getName());
+        nameView.erase(&user);
+        NameOrderKey key(user);
+        key.name = newName;
+        nameView.insertKey(std::move(key));
+        journalRecord(journal::RecordWriter(journal::RecordType::SetUserName).i32(user.getId()).str(newName));
+    }
+
+    void userAccessLevelChanging(const User& user, int newLevel) override {
+        auto it = usersById.find(user.getId());
+        if (it == usersById.end() || it->second != &user) return;
+        invalidateUser(user.getId());
+        accessLevelView.erase(&user);
+        AccessLevelOrderKey key(user);
+        key.level = newLevel;
+        accessLevelView.insertKey(key);
+        journalRecord(journal::RecordWriter(journal::RecordType::SetUserAccessLevel)
+                          .i32(user.getId()).u8(static_cast<uint8_t>(newLevel)));
+    }
+
+    void userAttributeChanging(const User& user, const std::string& newValue) override {
+        auto it = usersById.find(user.getId());
+        if (it == usersById.end() || it->second != &user) return;
+        journalRecord(journal::RecordWriter(journal::RecordType::SetUserAttribute).i32(user.getId()).str(newValue));
+    }
+
+    void resourceNameChanging(const Resource& resource, const std::string& newName) override {
+        auto it = resourcesByName.find(resource.getName());
+        if (it == resourcesByName.end() || &resources[it->second] != &resource) return;
+        if (resourcesByName.count(newName)) {
+            throw InvalidInputException("Ресурс с именем " + newName + " уже существует");
+        }
+        size_t index = it->second;
+        resourcesByName.erase(it);
+        resourcesByName.emplace(newName, index);
+        addToResourceFilter(newName);
+        invalidateResource(resource.getName());
+        invalidateResource(newName);
+        journalRecord(journal::RecordWriter(journal::RecordType::SetResourceName).str(resource.getName()).str(newName));
+    }
+
+    void resourceAccessLevelChanging(const Resource& resource, int newLevel) override {
+        auto it = resourcesByName.find(resource.getName());
+        if (it == resourcesByName.end() || &resources[it->second] != &resource) return;
+        invalidateResource(resource.getName());
+        resourceRoles[it->second] = RoleMask::forLevel(newLevel) | resource.getCustomRoles();
+        journalRecord(journal::RecordWriter(journal::RecordType::SetResourceAccessLevel)
+                          .str(resource.getName()).u8(static_cast<uint8_t>(newLevel)));
+    }
+
+    void userRolesChanging(const User& user, const RoleMask& newRoles) override {
+        auto it = usersById.find(user.getId());
+        if (it == usersById.end() || it->second != &user) return;
+        invalidateUser(user.getId());
+        journalRecord(journal::RecordWriter(journal::RecordType::SetUserRoles).i32(user.getId()).roles(newRoles));
+    }
+
+    void resourceRolesChanging(const Resource& resource, const RoleMask& newRoles) override {
+        auto it = resourcesByName.find(resource.getName());
+        if (it == resourcesByName.end() || &resources[it->second] != &resource) return;
+        invalidateResource(resource.getName());
+        resourceRoles[it->second] = RoleMask::forLevel(resource.getRequiredAccessLevel()) | newRoles;
+        journalRecord(journal::RecordWriter(journal::RecordType::SetResourceRoles)
+                          .str(resource.getName()).roles(newRoles));
+    }
+
+    void displayAllUsers() const {
+        for (const auto& user : users) {
+            user->displayInfo();
+        }
+    }
+
+    void displayAllResources() const {
+        for (const auto& resource : resources) {
+            resource.displayInfo();
+        }
+    }
+
+    // Проверка доступа без исключений и выделения памяти (для горячих путей).
+    // При включенном кэше промах записывает решение в кэш под мьютексом,
+    // при включенном аудите решение попадает в кольцо аудита текущего потока.
+    AccessDecision decideAccess(int userId, const std::string& resourceName) const noexcept {
+        AccessDecision decision = decideAccessUnaudited(userId, resourceName);
+        if (auditTrail) auditTrail->record(userId, resourceName, decision);
+        return decision;
+    }
+
+    // Включает аудит всех решений (decideAccess, checkAccess, пакетная проверка).
+    // Вызывать, пока другие потоки не проверяют доступ.
+    void enableAudit(const std::string& filename, const AuditTrail::Options& options = AuditTrail::Options()) {
+        auditTrail = std::make_shared<AuditTrail>(filename, options);
+    }
+
+    // Выключает аудит, дописав накопленные записи
+    void disableAudit() { auditTrail.reset(); }
+
+    void flushAudit() {
+        if (auditTrail) auditTrail->flush();
+    }
+
+    AuditTrail::Stats auditStats() const {
+        return auditTrail ? auditTrail->getStats() : AuditTrail::Stats();
+    }
+
+    // Включает кэш решений на capacity записей (0 - выключает).
+    // Пакетная проверка кэш не использует.
+    void setDecisionCacheCapacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        decisionCache = capacity > 0 ? std::make_unique<DecisionCache>(capacity) : nullptr;
+    }
+
+    DecisionCache::Stats decisionCacheStats() const {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        return decisionCache ? decisionCache->getStats() : DecisionCache::Stats();
+    }
+
+    // Включает фильтры Блума по ID пользователей и названиям ресурсов с заданной
+    // долей ложных срабатываний (0 - выключает). Заведомо неизвестные ключи
+    // отсеиваются до поиска в индексах и кэше. Фильтры перестраиваются при
+    // загрузке и росте справочника. Вызывать, пока другие потоки не проверяют доступ.
+    void setBloomFilters(double falsePositiveRate) {
+        if (falsePositiveRate != 0 && !(falsePositiveRate > 0 && falsePositiveRate < 1)) {
+            throw InvalidInputException("Доля ложных срабатываний должна быть от 0 до 1");
+        }
+        bloomFalsePositiveRate = falsePositiveRate;
+        userFilter.reset();
+        resourceFilter.reset();
+        rebuildBloomFilters();
+    }
+
+    double getBloomFalsePositiveRate() const { return bloomFalsePositiveRate; }
+
+    BloomFilter::Stats userFilterStats() const {
+        return userFilter ? userFilter->getStats() : BloomFilter::Stats();
+    }
+
+    BloomFilter::Stats resourceFilterStats() const {
+        return resourceFilter ? resourceFilter->getStats() : BloomFilter::Stats();
+    }
+
+    // Число потоков для пакетной проверки (1 - без пула)
+    void setWorkerThreads(unsigned count) {
+        workerPool = count > 1 ? std::make_unique<WorkerPool>(count) : nullptr;
+    }
+
+    unsigned getWorkerThreads() const { return workerPool ? workerPool->size() : 1; }
+
+    // Пакетная проверка: results[i] - решение для queries[i]. Сначала все названия
+    // ресурсов переводятся в индексы, затем запросы группируются по ресурсу и
+    // проверяются блоками в пуле потоков. Результат совпадает с decideAccess.
+    // Группировка выполняется, только если запросов не меньше, чем ресурсов:
+    // иначе ресурсы почти не повторяются и сортировка стоит дороже, чем экономит.
+    void decideAccessBatch(const AccessQuery* queries, size_t count, AccessDecision* results) const {
+        const uint32_t noResource = UINT32_MAX;
+        std::vector<uint64_t> order(count); // (индекс ресурса << 32) | номер запроса
+
+        parallelFor(count, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                uint64_t resource = noResource;
+                if (!resourceFilter || resourceFilter->mayContain(BloomFilter::hash(queries[i].resourceName))) {
+                    auto it = resourcesByName.find(queries[i].resourceName);
+                    if (it != resourcesByName.end()) resource = it->second;
+                    else if (resourceFilter) resourceFilter->noteFalsePositive();
+                }
+                order[i] = (resource << 32) | i;
+            }
+        });
+
+        if (count >= resources.size()) {
+            std::sort(order.begin(), order.end());
+        }
+
+        parallelFor(count, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                uint32_t resource = static_cast<uint32_t>(order[k] >> 32);
+                size_t i = static_cast<uint32_t>(order[k]);
+                const User* user = nullptr;
+                if (!userFilter || userFilter->mayContain(BloomFilter::hash(queries[i].userId))) {
+                    user = getUser(queries[i].userId);
+                    if (!user && userFilter) userFilter->noteFalsePositive();
+                }
+                if (!user) {
+                    results[i] = AccessDecision::UnknownUser;
+                } else if (resource == noResource) {
+                    results[i] = AccessDecision::UnknownResource;
+                } else {
+                    results[i] = resources[resource].checkAccess(*user) ? AccessDecision::Allowed
+                                                                       : AccessDecision::Denied;
+                }
+                if (auditTrail) auditTrail->record(queries[i].userId, queries[i].resourceName, results[i]);
+            }
+        });
+    }
+
+    std::vector<AccessDecision> decideAccessBatch(const std::vector<AccessQuery>& queries) const {
+        std::vector<AccessDecision> results(queries.size());
+        decideAccessBatch(queries.data(), queries.size(), results.data());
+        return results;
+    }
+
+    // Ресурсы, доступные пользователю, в порядке добавления. Требуемые роли
+    // всех ресурсов лежат подряд в resourceRoles и проверяются 128-битными
+    // операциями SSE2 (без SSE2 - парой 64-битных сравнений).
+    std::vector<const T*> reachableResources(int userId) const {
+        const User* user = getUser(userId);
+        if (!user) throw std::runtime_error("Пользователь с ID " + std::to_string(userId) + " не найден");
+        std::vector<const T*> reachable;
+        forEachReachable(user->getRoles(), [&](size_t i) { reachable.push_back(&resources[i]); });
+        return reachable;
+    }
+
+    size_t countReachableResources(int userId) const {
+        const User* user = getUser(userId);
+        if (!user) throw std::runtime_error("Пользователь с ID " + std::to_string(userId) + " не найден");
+        size_t count = 0;
+        forEachReachable(user->getRoles(), [&count](size_t) { ++count; });
+        return count;
+    }
+
+    // Обертка над decideAccess: сообщает об отказе исключением
+    bool checkAccess(int userId, const std::string& resourceName) const {
+        switch (decideAccess(userId, resourceName)) {
+            case AccessDecision::Allowed:
+                return true;
+            case AccessDecision::UnknownUser:
+                throw std::runtime_error("Пользователь с ID " + std::to_string(userId) + " не найден");
+            case AccessDecision::UnknownResource:
+                throw std::runtime_error("Ресурс с именем " + resourceName + " не найден");
+            case AccessDecision::Denied:
+                break;
+        }
+        throw AccessDeniedException("Доступ запрещен для пользователя " + getUser(userId)->getName() + 
+                                   " к ресурсу " + resourceName);
+    }
+
+    void clear() {
+        for (auto& user : users) user->setObserver(nullptr);
+        users.clear();
+        resources.clear();
+        resourceRoles.clear();
+        usersById.clear();
+        resourcesByName.clear();
+        namesIndex.clear();
+        nameView.clear();
+        accessLevelView.clear();
+        if (decisionCache) {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            decisionCache->clear();
+        }
+    }
+
+    // Текстовый формат: число пользователей и их записи, число ресурсов и их
+    // записи, затем число строк с дополнительными ролями и сами строки вида
+    // "U номер_записи роль роль ..." или "R номер_записи роль ...". В файлах
+    // старого формата раздела ролей нет - тогда роли не назначаются.
+    void saveToFile(const std::string& filename) const {
+        std::ofstream out(filename);
+        if (!out) throw std::runtime_error("Не удалось открыть файл для записи");
+
+        // Сохраняем пользователей
+        out << users.size() << "\n";
+        for (const auto& user : users) {
+            user->saveToFile(out);
+        }
+
+        // Сохраняем ресурсы
+        out << resources.size() << "\n";
+        for (const auto& resource : resources) {
+            resource.saveToFile(out);
+        }
+
+        // Дополнительные роли
+        std::ostringstream roles;
+        size_t roleLines = 0;
+        auto writeRoles = [&](char kind, size_t index, const RoleMask& mask) {
+            if (mask == RoleMask()) return;
+            roles << kind << ' ' << index;
+            for (unsigned role = RoleMask::firstCustomRole; role < RoleMask::bits; ++role) {
+                if (mask.test(role)) roles << ' ' << role;
+            }
+            roles << "\n";
+            ++roleLines;
+        };
+        for (size_t i = 0; i < users.size(); ++i) writeRoles('U', i, users[i]->getCustomRoles());
+        for (size_t i = 0; i < resources.size(); ++i) writeRoles('R', i, resources[i].getCustomRoles());
+        out << roleLines << "\n" << roles.str();
+        if (!out.flush()) throw std::runtime_error("Ошибка записи файла");
+    }
+
+    // Загрузка текстового файла. При ошибке выбрасывается исключение
+    // с описанием первой ошибки, а содержимое системы не меняется.
+    void loadFromFile(const std::string& filename) {
+        std::vector<LoadError> errors = loadFromFileParallel(filename);
+        if (!errors.empty()) {
+            throw InvalidInputException("Строка " + std::to_string(errors.front().line) + ": " +
+                                        errors.front().message);
+        }
+    }
+
+    // Параллельная загрузка текстового файла, записанного saveToFile.
+    // Файл отображается в память, начала строк ищутся по блокам в пуле потоков
+    // (setWorkerThreads), затем записи разбираются и проверяются параллельно.
+    // Новые пользователи и ресурсы собираются отдельно и подменяют текущие,
+    // только если ошибок нет; иначе возвращается список всех ошибок.
+    std::vector<LoadError> loadFromFileParallel(const std::string& filename) {
+        const size_t userLines = 5;     // тип, имя, ID, уровень, атрибут
+        const size_t resourceLines = 2; // название, уровень
+
+        MappedFile file(filename);
+        const char* data = file.data();
+        const size_t size = file.size();
+
+        // Начала строк: сначала число переводов строки в каждом блоке, затем сами позиции
+        const size_t blockBytes = 1 << 20;
+        size_t blocks = (size + blockBytes - 1) / blockBytes;
+        std::vector<size_t> blockLines(blocks + 1, 0);
+        parallelFor(blocks, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b) {
+                const char* p = data + b * blockBytes;
+                const char* last = data + std::min(size, (b + 1) * blockBytes);
+                size_t count = 0;
+                while ((p = static_cast<const char*>(std::memchr(p, '\n', last - p))) != nullptr) {
+                    ++count;
+                    ++p;
+                }
+                blockLines[b + 1] = count;
+            }
+        }, 1);
+        std::partial_sum(blockLines.begin(), blockLines.end(), blockLines.begin());
+        std::vector<size_t> lineStarts(blockLines[blocks] + 2);
+        lineStarts[0] = 0;
+        parallelFor(blocks, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b) {
+                size_t line = blockLines[b] + 1;
+                const char* p = data + b * blockBytes;
+                const char* last = data + std::min(size, (b + 1) * blockBytes);
+                while ((p = static_cast<const char*>(std::memchr(p, '\n', last - p))) != nullptr) {
+                    lineStarts[line++] = static_cast<size_t>(++p - data);
+                }
+            }
+        }, 1);
+        size_t lineCount = blockLines[blocks];
+        if (size > 0 && data[size - 1] != '\n') {
+            lineStarts[++lineCount] = size + 1; // последняя строка без перевода строки
+        }
+
+        auto line = [&](size_t index) {
+            if (index >= lineCount) return std::string_view();
+            size_t begin = lineStarts[index];
+            size_t end = std::min(lineStarts[index + 1] - 1, size);
+            if (end > begin && data[end - 1] == '\r') --end;
+            return std::string_view(data + begin, end - begin);
+        };
+        auto number = [](std::string_view text, long long& value) {
+            while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+            while (!text.empty() && text.back() == ' ') text.remove_suffix(1);
+            auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+            return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+        };
+
+        std::vector<LoadError> errors;
+        long long userCount = 0, resourceCount = 0;
+        if (!number(line(0), userCount) || userCount < 0 ||
+            static_cast<unsigned long long>(userCount) * userLines + 1 > lineCount) {
+            return {{1, 0, "Неверное число пользователей"}};
+        }
+        size_t resourceHeader = 1 + static_cast<size_t>(userCount) * userLines;
+        if (!number(line(resourceHeader), resourceCount) || resourceCount < 0 ||
+            resourceHeader + 1 + static_cast<unsigned long long>(resourceCount) * resourceLines > lineCount) {
+            return {{resourceHeader + 1, 0, "Неверное число ресурсов"}};
+        }
+
+        std::mutex errorsMutex;
+        auto fail = [&](size_t lineIndex, size_t record, const std::string& message) {
+            std::lock_guard<std::mutex> lock(errorsMutex);
+            errors.push_back({lineIndex + 1, record + 1, message});
+        };
+
+        const std::string studentType = typeid(Student).name();
+        const std::string teacherType = typeid(Teacher).name();
+        const std::string administratorType = typeid(Administrator).name();
+
+        std::vector<std::unique_ptr<User>> newUsers(static_cast<size_t>(userCount));
+        parallelFor(newUsers.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                size_t first = 1 + i * userLines;
+                std::string_view type = line(first);
+                UserKind kind;
+                if (type == studentType) kind = UserKind::Student;
+                else if (type == teacherType) kind = UserKind::Teacher;
+                else if (type == administratorType) kind = UserKind::Administrator;
+                else {
+                    fail(first, i, "Неизвестный тип пользователя в файле");
+                    continue;
+                }
+                long long id = 0, level = 0;
+                if (!number(line(first + 2), id) || id < INT32_MIN || id > INT32_MAX) {
+                    fail(first + 2, i, "Неверный ID пользователя");
+                    continue;
+                }
+                if (!number(line(first + 3), level) || level < INT32_MIN || level > INT32_MAX) {
+                    fail(first + 3, i, "Неверный уровень доступа");
+                    continue;
+                }
+                try {
+                    auto user = makeUser(kind, std::string(line(first + 1)), static_cast<int>(id),
+                                         std::string(line(first + 4)));
+                    if (user->getAccessLevel() != level) user->setAccessLevel(static_cast<int>(level));
+                    newUsers[i] = std::move(user);
+                } catch (const std::exception& e) {
+                    fail(first, i, e.what());
+                }
+            }
+        });
+
+        std::vector<T> newResources(static_cast<size_t>(resourceCount));
+        parallelFor(newResources.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                size_t first = resourceHeader + 1 + i * resourceLines;
+                long long level = 0;
+                if (!number(line(first + 1), level) || level < INT32_MIN || level > INT32_MAX) {
+                    fail(first + 1, i, "Неверный требуемый уровень доступа");
+                    continue;
+                }
+                try {
+                    newResources[i] = T(std::string(line(first)), static_cast<int>(level));
+                } catch (const std::exception& e) {
+                    fail(first, i, e.what());
+                }
+            }
+        });
+
+        // Раздел дополнительных ролей (его может не быть)
+        size_t rolesHeader = resourceHeader + 1 + static_cast<size_t>(resourceCount) * resourceLines;
+        long long roleLines = 0;
+        if (rolesHeader < lineCount && !line(rolesHeader).empty()) {
+            if (!number(line(rolesHeader), roleLines) || roleLines < 0 ||
+                rolesHeader + 1 + static_cast<unsigned long long>(roleLines) > lineCount) {
+                errors.push_back({rolesHeader + 1, 0, "Неверное число строк с ролями"});
+                roleLines = 0;
+            }
+        }
+        for (size_t i = 0; i < static_cast<size_t>(roleLines); ++i) {
+            size_t index = rolesHeader + 1 + i;
+            std::istringstream in{std::string(line(index))};
+            char kind = 0;
+            long long record = -1;
+            in >> kind >> record;
+            size_t count = kind == 'U' ? newUsers.size() : kind == 'R' ? newResources.size() : 0;
+            if (!in || record < 0 || static_cast<unsigned long long>(record) >= count) {
+                errors.push_back({index + 1, i + 1, "Неверная строка с ролями"});
+                continue;
+            }
+            try {
+                RoleMask mask;
+                long long role;
+                while (in >> role) {
+                    if (role < 0 || role > RoleMask::bits) role = RoleMask::bits; // вне допустимого диапазона
+                    RoleMask::checkCustomRole(static_cast<unsigned>(role));
+                    mask.set(static_cast<unsigned>(role));
+                }
+                if (!in.eof()) throw InvalidInputException("Неверный номер роли");
+                if (kind == 'U') {
+                    if (newUsers[record]) newUsers[record]->setCustomRoles(mask);
+                } else {
+                    newResources[record].setCustomRoles(mask);
+                }
+            } catch (const std::exception& e) {
+                errors.push_back({index + 1, i + 1, e.what()});
+            }
+        }
+
+        // Повторы проверяются по уже разобранным записям
+        std::unordered_set<int> seenIds;
+        seenIds.reserve(newUsers.size());
+        for (size_t i = 0; i < newUsers.size(); ++i) {
+            if (newUsers[i] && !seenIds.insert(newUsers[i]->getId()).second) {
+                errors.push_back({4 + i * userLines, i + 1,
+                                  "Пользователь с ID " + std::to_string(newUsers[i]->getId()) + " уже существует"});
+            }
+        }
+        std::unordered_set<std::string> seenNames;
+        seenNames.reserve(newResources.size());
+        for (size_t i = 0; i < newResources.size(); ++i) {
+            const std::string& name = newResources[i].getName();
+            if (!name.empty() && !seenNames.insert(name).second) {
+                errors.push_back({resourceHeader + 2 + i * resourceLines, i + 1,
+                                  "Ресурс с именем " + name + " уже существует"});
+            }
+        }
+        if (!errors.empty()) {
+            std::sort(errors.begin(), errors.end(),
+                      [](const LoadError& a, const LoadError& b) { return a.line < b.line; });
+            return errors;
+        }
+
+        replaceContents(std::move(newUsers), std::move(newResources));
+        if (changeJournal && !journalPaused) compactJournal();
+        return errors;
+    }
+
+    // Сохранение в бинарный снимок (см. namespace snapshot). Файл сначала
+    // пишется во временный и затем переименовывается, чтобы не оставить его недописанным.
+    void saveSnapshot(const std::string& filename) const {
+        writeSnapshot(filename, journalGeneration);
+    }
+
+private:
+    void writeSnapshot(const std::string& filename, uint32_t generation) const {
+        snapshot::StringTableBuilder strings;
+        std::vector<int32_t> ids(users.size());
+        std::vector<uint8_t> kinds(users.size()), levels(users.size());
+        std::vector<snapshot::StringRef> names(users.size()), attributes(users.size());
+        std::vector<RoleMask> userRoles(users.size());
+        for (size_t i = 0; i < users.size(); ++i) {
+            const User& user = *users[i];
+            ids[i] = user.getId();
+            userRoles[i] = user.getCustomRoles();
+            kinds[i] = static_cast<uint8_t>(user.getKind());
+            levels[i] = static_cast<uint8_t>(user.getAccessLevel());
+            names[i] = strings.add(user.getName());
+            attributes[i] = strings.addShared(user.getAttribute());
+        }
+        std::vector<uint8_t> resourceLevels(resources.size());
+        std::vector<snapshot::StringRef> resourceNames(resources.size());
+        std::vector<RoleMask> resourceCustomRoles(resources.size());
+        for (size_t i = 0; i < resources.size(); ++i) {
+            resourceLevels[i] = static_cast<uint8_t>(resources[i].getRequiredAccessLevel());
+            resourceCustomRoles[i] = resources[i].getCustomRoles();
+            resourceNames[i] = strings.add(resources[i].getName());
+        }
+
+        snapshot::Header header = {};
+        std::memcpy(header.magic, snapshot::magic, sizeof(header.magic));
+        header.version = snapshot::version;
+        header.byteOrder = snapshot::byteOrderMark;
+        header.journalGeneration = generation;
+        header.userCount = users.size();
+        header.resourceCount = resources.size();
+        header.stringBytes = strings.data().size();
+        snapshot::Layout layout(header.version, header.userCount, header.resourceCount, header.stringBytes);
+
+        std::string tempName = filename + ".tmp";
+        {
+            std::ofstream out(tempName, std::ios::binary | std::ios::trunc);
+            if (!out) throw std::runtime_error("Не удалось открыть файл для записи");
+            auto column = [&out](size_t offset, const void* data, size_t bytes) {
+                static const char zeros[8] = {};
+                size_t position = static_cast<size_t>(out.tellp());
+                out.write(zeros, offset - position);
+                out.write(static_cast<const char*>(data), bytes);
+            };
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            column(layout.userIds, ids.data(), ids.size() * sizeof(int32_t));
+            column(layout.userKinds, kinds.data(), kinds.size());
+            column(layout.userLevels, levels.data(), levels.size());
+            column(layout.userNames, names.data(), names.size() * sizeof(snapshot::StringRef));
+            column(layout.userAttributes, attributes.data(), attributes.size() * sizeof(snapshot::StringRef));
+            column(layout.resourceLevels, resourceLevels.data(), resourceLevels.size());
+            column(layout.resourceNames, resourceNames.data(), resourceNames.size() * sizeof(snapshot::StringRef));
+            column(layout.userRoles, userRoles.data(), userRoles.size() * sizeof(RoleMask));
+            column(layout.resourceRoles, resourceCustomRoles.data(), resourceCustomRoles.size() * sizeof(RoleMask));
+            column(layout.strings, strings.data().data(), strings.data().size());
+            if (!out.flush()) throw std::runtime_error("Ошибка записи снимка");
+        }
+        replaceFileDurably(tempName, filename);
+    }
+
+public:
+    // Загрузка бинарного снимка за один проход по отображенному в память файлу.
+    // При ошибке содержимое системы не меняется.
+    void loadSnapshot(const std::string& filename) {
+        MappedFile file(filename);
+        snapshot::Header header;
+        if (file.size() < sizeof(header)) throw std::runtime_error("Файл снимка поврежден");
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, snapshot::magic, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("Файл не является снимком системы");
+        }
+        if (header.version < 1 || header.version > snapshot::version || header.byteOrder != snapshot::byteOrderMark) {
+            throw std::runtime_error("Неподдерживаемая версия снимка");
+        }
+        if (header.userCount > file.size() || header.resourceCount > file.size() ||
+            header.stringBytes > file.size()) {
+            throw std::runtime_error("Файл снимка поврежден");
+        }
+        snapshot::Layout layout(header.version, header.userCount, header.resourceCount, header.stringBytes);
+        if (layout.total > file.size()) throw std::runtime_error("Файл снимка поврежден");
+
+        const char* base = file.data();
+        const char* strings = base + layout.strings;
+        auto text = [&](const snapshot::StringRef& ref) {
+            if (uint64_t(ref.offset) + ref.length > header.stringBytes) {
+                throw std::runtime_error("Файл снимка поврежден");
+            }
+            return std::string(strings + ref.offset, ref.length);
+        };
+
+        const int32_t* ids = reinterpret_cast<const int32_t*>(base + layout.userIds);
+        const uint8_t* kinds = reinterpret_cast<const uint8_t*>(base + layout.userKinds);
+        const uint8_t* levels = reinterpret_cast<const uint8_t*>(base + layout.userLevels);
+        const auto* names = reinterpret_cast<const snapshot::StringRef*>(base + layout.userNames);
+        const auto* attributes = reinterpret_cast<const snapshot::StringRef*>(base + layout.userAttributes);
+        const bool hasRoles = header.version >= 2;
+        auto roles = [&](size_t offset, size_t i) {
+            RoleMask mask;
+            std::memcpy(&mask, base + offset + i * sizeof(RoleMask), sizeof(RoleMask));
+            return mask;
+        };
+
+        std::vector<std::unique_ptr<User>> newUsers;
+        newUsers.reserve(header.userCount);
+        for (size_t i = 0; i < header.userCount; ++i) {
+            auto user = makeUser(static_cast<UserKind>(kinds[i]), text(names[i]), ids[i], text(attributes[i]));
+            if (user->getAccessLevel() != levels[i]) user->setAccessLevel(levels[i]);
+            if (hasRoles) user->setCustomRoles(roles(layout.userRoles, i));
+            newUsers.push_back(std::move(user));
+        }
+
+        const uint8_t* resourceLevels = reinterpret_cast<const uint8_t*>(base + layout.resourceLevels);
+        const auto* resourceNames = reinterpret_cast<const snapshot::StringRef*>(base + layout.resourceNames);
+        std::vector<T> newResources;
+        newResources.reserve(header.resourceCount);
+        for (size_t i = 0; i < header.resourceCount; ++i) {
+            newResources.emplace_back(text(resourceNames[i]), resourceLevels[i]);
+            if (hasRoles) newResources.back().setCustomRoles(roles(layout.resourceRoles, i));
+        }
+
+        replaceContents(std::move(newUsers), std::move(newResources));
+        journalGeneration = header.journalGeneration;
+        if (changeJournal && !journalPaused) compactJournal();
+    }
+
+    // Сохранение в файл дискового справочника (см. namespace btree), который
+    // открывается DiskDirectory. Как и снимок, пишется через временный файл.
+    void saveDiskDirectory(const std::string& filename) const {
+        std::vector<btree::Entry> byId, byName, resourceEntries;
+        byId.reserve(users.size());
+        byName.reserve(users.size());
+        for (const auto& user : users) {
+            std::string key = btree::intKey(user->getId());
+            byId.emplace_back(key, btree::userValue(*user));
+            byName.emplace_back(user->getName(), std::move(key));
+        }
+        resourceEntries.reserve(resources.size());
+        for (const auto& resource : resources) {
+            resourceEntries.emplace_back(resource.getName(),
+                                         btree::resourceValue(resource.getRequiredAccessLevel(), resource.getCustomRoles()));
+        }
+        std::sort(byId.begin(), byId.end());
+        std::sort(byName.begin(), byName.end());
+        std::sort(resourceEntries.begin(), resourceEntries.end());
+
+        std::string tempName = filename + ".tmp";
+        {
+            btree::FileWriter writer(tempName);
+            btree::FileHeader header = {};
+            header.usersById = writer.writeTree(byId);
+            header.usersByName = writer.writeTree(byName);
+            header.resourcesByName = writer.writeTree(resourceEntries);
+            writer.finish(header);
+        }
+        replaceFileDurably(tempName, filename);
+    }
+
+    // Поиск по началу имени без учета регистра (для подсказок при вводе)
+    NameIndex::Range findUsersByNamePrefix(const std::string& prefix) const {
+        return namesIndex.withPrefix(prefix);
+    }
+
+    // Поиск по началу любого слова в имени: "иван" найдет и "Иванов Петр", и "Петров Иван"
+    std::vector<const User*> findUsersByWordPrefix(const std::string& prefix, size_t limit = 20) const {
+        return namesIndex.withWordPrefix(prefix, limit);
+    }
+
+    // Пользователи с заданной группой, кафедрой или должностью: строка ищется
+    // в AttributePool один раз, дальше сравниваются номера
+    std::vector<const User*> findUsersByAttribute(const std::string& value) const {
+        std::vector<const User*> found;
+        uint32_t id;
+        if (!AttributePool::instance().find(value, id)) return found;
+        for (const auto& user : users) {
+            if (user->getAttributeId() == id) found.push_back(user.get());
+        }
+        return found;
+    }
+
+    void findUserByName(const std::string& name) const {
+        bool found = false;
+        for (const User& user : namesIndex.equal(name)) {
+            if (user.getName() == name) {
+                user.displayInfo();
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cout << "Пользователь с именем " << name << " не найден" << std::endl;
+        }
+    }
+
+    void findUserById(int id) const {
+        const User* user = getUser(id);
+        if (user) {
+            user->displayInfo();
+        } else {
+            std::cout << "Пользователь с ID " << id << " не найден" << std::endl;
+        }
+    }
+
+    // Представления пользователей, отсортированные по имени и по уровню доступа.
+    // Доступны одновременно и не копируют объекты пользователей.
+    const SortedUserView<NameOrderKey>& usersByName() const { return nameView; }
+    const SortedUserView<AccessLevelOrderKey>& usersByAccessLevel() const { return accessLevelView; }
+
+    void sortUsersByAccessLevel() {
+        reorderUsers(accessLevelView);
+        journalRecord(journal::RecordWriter(journal::RecordType::SortByAccessLevel));
+        compactJournalIfNeeded();
+    }
+
+    void sortUsersByName() {
+        reorderUsers(nameView);
+        journalRecord(journal::RecordWriter(journal::RecordType::SortByName));
+        compactJournalIfNeeded();
+    }
+
+    // Восстанавливает состояние из снимка и журнала и дальше ведет журнал:
+    // каждое изменение дописывается в journalFile, а при превышении
+    // options.compactAfterBytes журнал сворачивается в snapshotFile.
+    // Если снимка нет, система начинается пустой. Возвращает число
+    // воспроизведенных записей журнала.
+    size_t enableJournal(const std::string& snapshotFile, const std::string& journalFile,
+                         const Journal::Options& options = Journal::Options()) {
+        changeJournal.reset();
+        struct stat info;
+        if (::stat(snapshotFile.c_str(), &info) == 0) {
+            loadSnapshot(snapshotFile);
+        } else {
+            clear();
+            journalGeneration = 0;
+        }
+
+        uint32_t generation = 0;
+        size_t validBytes = 0;
+        bool exists = journal::readGeneration(journalFile, generation, validBytes);
+        size_t replayed = 0;
+        if (exists && generation == journalGeneration) {
+            JournalPause pause(journalPaused);
+            MappedFile file(journalFile);
+            journal::forEachRecord(file.data(), validBytes, [&](journal::RecordType type, journal::RecordReader& in) {
+                applyJournalRecord(type, in);
+                ++replayed;
+            });
+            --replayed; // заголовок
+        } else if (exists && generation > journalGeneration) {
+            throw std::runtime_error("Журнал новее снимка");
+        } else {
+            exists = false; // журнал уже свернут в снимок - начинаем новый
+        }
+
+        changeJournal = std::make_unique<Journal>(journalFile, journalGeneration, exists, validBytes, options);
+        journalSnapshotFile = snapshotFile;
+        return replayed;
+    }
+
+    void disableJournal() { changeJournal.reset(); }
+
+    // Ждет записи всех изменений журнала на диск
+    void commitJournal() {
+        if (changeJournal) changeJournal->sync();
+    }
+
+    // Сворачивает журнал в снимок: снимок записывается с новым поколением
+    // и сбрасывается на диск, после чего журнал начинается заново. Если
+    // процесс прервется между этими шагами, при восстановлении старый журнал
+    // будет пропущен. Если снимок записать не удалось, поколение и журнал
+    // остаются прежними.
+    void compactJournal() {
+        if (!changeJournal) throw std::runtime_error("Журнал изменений не ведется");
+        changeJournal->sync();
+        writeSnapshot(journalSnapshotFile, journalGeneration + 1);
+        ++journalGeneration;
+        changeJournal->restart(journalGeneration);
+    }
+
+    Journal::Stats journalStats() const {
+        return changeJournal ? changeJournal->getStats() : Journal::Stats();
+    }
+};
+
+// Эпохи читателей для безопасного освобождения старых версий данных
+// (epoch-based reclamation). Каждый поток-читатель занимает свой слот и на время
+// чтения записывает в него текущую эпоху. Объект, снятый с публикации в эпоху E,
+// можно удалить, когда ни один слот не содержит эпоху меньше E.
+class EpochManager {
+private:
+    static constexpr size_t maxThreads = 512;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0}; // 0 - поток сейчас не читает
+        std::atomic<bool> taken{false};
+    };
+
+    Slot slots[maxThreads];
+    std::atomic<uint64_t> globalEpoch{1};
+
+    // Слот потока освобождается при завершении потока
+    struct ThreadSlot {
+        EpochManager* owner = nullptr;
+        size_t index = 0;
+        unsigned depth = 0;
+        ~ThreadSlot() {
+            if (owner) owner->slots[index].taken.store(false, std::memory_order_release);
+        }
+    };
+
+    ThreadSlot& threadSlot() {
+        thread_local ThreadSlot slot;
+        if (!slot.owner) {
+            for (size_t i = 0; i < maxThreads; ++i) {
+                bool expected = false;
+                if (slots[i].taken.compare_exchange_strong(expected, true)) {
+                    slot.owner = this;
+                    slot.index = i;
+                    return slot;
+                }
+            }
+            throw std::runtime_error("Слишком много потоков-читателей");
+        }
+        return slot;
+    }
+
+public:
+    static EpochManager& instance() {
+        static EpochManager manager;
+        return manager;
+    }
+
+    // Вложенные чтения допускаются: слот освобождается при выходе из внешнего
+    void enter() {
+        ThreadSlot& slot = threadSlot();
+        if (slot.depth++ == 0) {
+            slots[slot.index].epoch.store(globalEpoch.load(), std::memory_order_seq_cst);
+        }
+    }
+
+    void leave() {
+        ThreadSlot& slot = threadSlot();
+        if (--slot.depth == 0) {
+            slots[slot.index].epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    // Вызывается писателем после снятия объекта с публикации
+    uint64_t advance() { return globalEpoch.fetch_add(1) + 1; }
+
+    // true, если ни один читатель не мог видеть объекты, снятые до эпохи epoch
+    bool isQuiescent(uint64_t epoch) const {
+        for (const auto& slot : slots) {
+            uint64_t current = slot.epoch.load(std::memory_order_seq_cst);
+            if (current != 0 && current < epoch) return false;
+        }
+        return true;
+    }
+};
+
+// Потокобезопасная система для сценария "много читателей, редкие изменения".
+// Читатели работают с неизменяемой опубликованной версией и никогда не ждут.
+// Писатель копирует текущую версию, изменяет копию и публикует ее атомарной
+// заменой указателя; старые версии удаляются, когда их перестают читать.
+// Каждое изменение копирует весь справочник, поэтому несколько изменений
+// лучше объединять в один вызов update.
+template<typename T>
+class ConcurrentAccessControlSystem {
+private:
+    using System = AccessControlSystem<T>;
+
+    struct Retired {
+        const System* version;
+        uint64_t epoch;
+    };
+
+    std::atomic<const System*> current;
+    mutable std::mutex writerMutex;
+    std::vector<Retired> retired;
+    std::atomic<uint64_t> versionCount{1};
+
+    class ReadGuard {
+    public:
+        ReadGuard() { EpochManager::instance().enter(); }
+        ~ReadGuard() { EpochManager::instance().leave(); }
+    };
+
+    void publish(std::unique_ptr<System> next) {
+        const System* old = current.exchange(next.release());
+        retired.push_back({old, EpochManager::instance().advance()});
+        versionCount.fetch_add(1, std::memory_order_relaxed);
+        reclaimLocked();
+    }
+
+    void reclaimLocked() {
+        auto& epochs = EpochManager::instance();
+        auto keep = std::remove_if(retired.begin(), retired.end(), [&](const Retired& r) {
+            if (!epochs.isQuiescent(r.epoch)) return false;
+            delete r.version;
+            return true;
+        });
+        retired.erase(keep, retired.end());
+    }
+
+public:
+    ConcurrentAccessControlSystem() : current(new System()) {}
+
+    ConcurrentAccessControlSystem(const ConcurrentAccessControlSystem&) = delete;
+    ConcurrentAccessControlSystem& operator=(const ConcurrentAccessControlSystem&) = delete;
+
+    // К моменту разрушения читателей быть не должно
+    ~ConcurrentAccessControlSystem() {
+        for (const auto& r : retired) delete r.version;
+        delete current.load();
+    }
+
+    // Выполняет fn над текущей версией; версия не изменится и не будет удалена до выхода из fn
+    template<typename Fn>
+    auto read(Fn&& fn) const {
+        ReadGuard guard;
+        return fn(static_cast<const System&>(*current.load()));
+    }
+
+    AccessDecision decideAccess(int userId, const std::string& resourceName) const {
+        return read([&](const System& system) { return system.decideAccess(userId, resourceName); });
+    }
+
+    bool checkAccess(int userId, const std::string& resourceName) const {
+        return read([&](const System& system) { return system.checkAccess(userId, resourceName); });
+    }
+
+    // Применяет изменение к копии текущей версии и публикует ее.
+    // Если mutation выбросит исключение, опубликованная версия не меняется.
+    void update(const std::function<void(System&)>& mutation) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        auto next = current.load()->clone();
+        mutation(*next);
+        publish(std::move(next));
+    }
+
+    struct ReloadStats {
+        double buildSeconds = 0;   // сборка новой версии, читатели работают со старой
+        double publishSeconds = 0; // замена указателя на текущую версию
+        double reclaimSeconds = 0; // ожидание читателей старой версии и ее удаление
+        bool oldVersionFreed = false;
+        size_t users = 0;
+        size_t resources = 0;
+    };
+
+    // Собирает новую версию с нуля функцией build и публикует ее одной атомарной
+    // заменой; читатели все это время работают со старой версией и не ждут.
+    // Старая версия удаляется, как только из нее выйдут читатели (ожидание не
+    // дольше maxReclaimWait, иначе ее удалит следующая публикация или reclaim).
+    // Если build выбросит исключение, опубликованная версия не меняется.
+    // Вызовы update ждут на время сборки, но не на время ожидания читателей:
+    // оно идет без блокировки писателей.
+    ReloadStats reload(const std::function<void(System&)>& build,
+                       std::chrono::milliseconds maxReclaimWait = std::chrono::milliseconds(1000)) {
+        using Clock = std::chrono::steady_clock;
+        auto seconds = [](Clock::time_point start) {
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+        std::unique_lock<std::mutex> lock(writerMutex);
+        ReloadStats stats;
+
+        auto start = Clock::now();
+        auto next = current.load()->emptyCopy();
+        build(*next);
+        next->setWorkerThreads(1); // пул потоков загрузки опубликованной версии не нужен
+        stats.users = next->userCount();
+        stats.resources = next->resourceCount();
+        stats.buildSeconds = seconds(start);
+
+        start = Clock::now();
+        const System* old = current.load();
+        publish(std::move(next));
+        uint64_t oldEpoch = retired.empty() ? 0 : retired.back().epoch;
+        stats.publishSeconds = seconds(start);
+
+        // Старую версию могла уже удалить publish; иначе ждем ее читателей,
+        // отпуская мьютекс писателей между проверками
+        start = Clock::now();
+        auto isRetired = [&] {
+            return std::any_of(retired.begin(), retired.end(), [&](const Retired& r) {
+                return r.version == old && r.epoch == oldEpoch;
+            });
+        };
+        bool waiting = isRetired();
+        while (waiting && Clock::now() - start < maxReclaimWait) {
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+            reclaimLocked();
+            waiting = isRetired();
+        }
+        stats.oldVersionFreed = !waiting;
+        stats.reclaimSeconds = seconds(start);
+        return stats;
+    }
+
+    // Перезагрузка из текстового файла параллельным загрузчиком. При ошибках
+    // в файле выбрасывается исключение с первой ошибкой, версия не меняется.
+    ReloadStats reloadFromFile(const std::string& filename,
+                               unsigned threads = std::max(1u, std::thread::hardware_concurrency())) {
+        return reload([&](System& next) {
+            next.setWorkerThreads(threads);
+            next.loadFromFile(filename);
+        });
+    }
+
+    ReloadStats reloadSnapshot(const std::string& filename) {
+        return reload([&](System& next) { next.loadSnapshot(filename); });
+    }
+
+    void addUser(std::unique_ptr<User> user) {
+        update([&](System& system) { system.addUser(std::move(user)); });
+    }
+
+    void addResource(const T& resource) {
+        update([&](System& system) { system.addResource(resource); });
+    }
+
+    void sortUsersByName() {
+        update([](System& system) { system.sortUsersByName(); });
+    }
+
+    void sortUsersByAccessLevel() {
+        update([](System& system) { system.sortUsersByAccessLevel(); });
+    }
+
+    // Удаляет старые версии, которые больше никто не читает
+    void reclaim() {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        reclaimLocked();
+    }
+
+    size_t pendingVersions() const {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        return retired.size();
+    }
+
+    uint64_t publishedVersions() const { return versionCount.load(std::memory_order_relaxed); }
+};
+
+// Сервер команд без интерактивного меню (для работы за шлюзом).
+// Один запрос - одна строка, поля разделены табуляцией; ответ - одна строка
+// "OK[\t...]" или "ERR\t<сообщение>" в порядке запросов:
+//   CHECK id ресурс             -> OK allowed|denied|unknown_user|unknown_resource
+//   USER id                     -> OK id тип уровень имя атрибут
+//   FIND имя                    -> OK число id... (полное совпадение имени)
+//   REACH id                    -> OK число доступных ресурсов
+//   STATS                       -> OK пользователей ресурсов версий
+//   PING                        -> OK
+//   ADDUSER тип id имя атрибут  -> OK
+//   ADDRESOURCE название уровень -> OK
+//   REMOVEUSER id               -> OK
+//   SETLEVEL id уровень         -> OK
+//   GRANT id роль               -> OK
+//   RELOAD text|snapshot файл   -> OK пользователей ресурсов мс (замена всего справочника)
+//   QUIT                        -> закрывает соединение
+// Запросы можно отправлять подряд, не дожидаясь ответов: все прочитанные
+// запросы обрабатываются, и ответы уходят одной записью. Идущие подряд
+// изменения применяются к одной копии справочника и публикуются один раз.
+class CommandServer {
+private:
+    using System = AccessControlSystem<Resource>;
+
+    ConcurrentAccessControlSystem<Resource>& system;
+    std::vector<std::string_view> fields;
+
+    static bool toInt(std::string_view text, int& value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    static void appendInt(std::string& out, long long value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+
+    static bool isMutation(std::string_view command) {
+        return command == "ADDUSER" || command == "ADDRESOURCE" || command == "REMOVEUSER" ||
+               command == "SETLEVEL" || command == "GRANT";
+    }
+
+    void split(std::string_view line) {
+        fields.clear();
+        size_t start = 0;
+        while (true) {
+            size_t tab = line.find('\t', start);
+            fields.push_back(line.substr(start, tab == std::string_view::npos ? std::string_view::npos : tab - start));
+            if (tab == std::string_view::npos) break;
+            start = tab + 1;
+        }
+    }
+
+    static void error(std::string& out, const std::string& message) {
+        out += "ERR\t";
+        out += message;
+        out += '\n';
+    }
+
+    void requireFields(size_t count) const {
+        if (fields.size() != count) {
+            throw InvalidInputException("Ожидается полей: " + std::to_string(count) + ", получено: " +
+                                        std::to_string(fields.size()));
+        }
+    }
+
+    int intField(size_t index) const {
+        int value;
+        if (!toInt(fields[index], value)) throw InvalidInputException("Ожидается число: " + std::string(fields[index]));
+        return value;
+    }
+
+    // Запросы на чтение к опубликованной версии
+    void handleRead(const System& current, std::string& out) {
+        std::string_view command = fields[0];
+        if (command == "CHECK") {
+            requireFields(3);
+            static const char* names[] = {"allowed", "denied", "unknown_user", "unknown_resource"};
+            out += "OK\t";
+            out += names[static_cast<int>(current.decideAccess(intField(1), std::string(fields[2])))];
+            out += '\n';
+        } else if (command == "USER") {
+            requireFields(2);
+            const User* user = current.getUser(intField(1));
+            if (!user) throw InvalidInputException("Пользователь не найден");
+            static const char* kinds[] = {"", "student", "teacher", "administrator"};
+            out += "OK\t";
+            appendInt(out, user->getId());
+            out += '\t';
+            out += kinds[static_cast<int>(user->getKind())];
+            out += '\t';
+            appendInt(out, user->getAccessLevel());
+            out += '\t';
+            out += user->getName();
+            out += '\t';
+            out += user->getAttribute();
+            out += '\n';
+        } else if (command == "FIND") {
+            requireFields(2);
+            std::string name(fields[1]);
+            std::string ids;
+            size_t count = 0;
+            for (const User& user : current.findUsersByNamePrefix(name)) {
+                if (user.getName() != name) continue;
+                ids += '\t';
+                appendInt(ids, user.getId());
+                ++count;
+            }
+            out += "OK\t";
+            appendInt(out, static_cast<long long>(count));
+            out += ids;
+            out += '\n';
+        } else if (command == "REACH") {
+            requireFields(2);
+            out += "OK\t";
+            appendInt(out, static_cast<long long>(current.countReachableResources(intField(1))));
+            out += '\n';
+        } else if (command == "STATS") {
+            requireFields(1);
+            out += "OK\t";
+            appendInt(out, static_cast<long long>(current.userCount()));
+            out += '\t';
+            appendInt(out, static_cast<long long>(current.resourceCount()));
+            out += '\t';
+            appendInt(out, static_cast<long long>(system.publishedVersions()));
+            out += '\n';
+        } else if (command == "PING") {
+            out += "OK\n";
+        } else {
+            throw InvalidInputException("Неизвестная команда: " + std::string(command));
+        }
+    }
+
+    // Новая версия собирается в фоне, остальные соединения продолжают читать старую
+    void handleReload(std::string& out) {
+        requireFields(3);
+        std::string filename(fields[2]);
+        ConcurrentAccessControlSystem<Resource>::ReloadStats stats;
+        if (fields[1] == "text") stats = system.reloadFromFile(filename);
+        else if (fields[1] == "snapshot") stats = system.reloadSnapshot(filename);
+        else throw InvalidInputException("Формат должен быть text или snapshot");
+        out += "OK\t";
+        appendInt(out, static_cast<long long>(stats.users));
+        out += '\t';
+        appendInt(out, static_cast<long long>(stats.resources));
+        out += '\t';
+        appendInt(out, static_cast<long long>((stats.buildSeconds + stats.publishSeconds) * 1000));
+        out += '\n';
+    }
+
+    // Изменение копии справочника, которая будет опубликована
+    void handleMutation(System& next, std::string& out) {
+        std::string_view command = fields[0];
+        if (command == "ADDUSER") {
+            requireFields(5);
+            UserKind kind;
+            if (!parseUserKind(std::string(fields[1]), kind)) {
+                throw InvalidInputException("Неизвестный тип пользователя: " + std::string(fields[1]));
+            }
+            next.addUser(makeUser(kind, std::string(fields[3]), intField(2), std::string(fields[4])));
+        } else if (command == "ADDRESOURCE") {
+            requireFields(3);
+            next.addResource(Resource(std::string(fields[1]), intField(2)));
+        } else if (command == "REMOVEUSER") {
+            requireFields(2);
+            if (!next.removeUser(intField(1))) throw InvalidInputException("Пользователь не найден");
+        } else if (command == "SETLEVEL" || command == "GRANT") {
+            requireFields(3);
+            User* user = next.getUser(intField(1));
+            if (!user) throw InvalidInputException("Пользователь не найден");
+            if (command == "SETLEVEL") user->setAccessLevel(intField(2));
+            else user->grantRole(static_cast<unsigned>(intField(2)));
+        }
+        out += "OK\n";
+    }
+
+    // Обрабатывает готовые строки; false - получена команда QUIT
+    bool process(const std::vector<std::string_view>& lines, std::string& out) {
+        size_t i = 0;
+        while (i < lines.size()) {
+            split(lines[i]);
+            if (fields[0] == "QUIT") return false;
+            size_t end = i + 1;
+            if (fields[0] == "RELOAD") {
+                try {
+                    handleReload(out);
+                } catch (const std::exception& e) {
+                    error(out, e.what());
+                }
+            } else if (isMutation(fields[0])) {
+                while (end < lines.size() && isMutation(lines[end].substr(0, lines[end].find('\t')))) ++end;
+                size_t mark = out.size();
+                try {
+                    system.update([&](System& next) {
+                        for (size_t k = i; k < end; ++k) {
+                            split(lines[k]);
+                            try {
+                                handleMutation(next, out);
+                            } catch (const std::exception& e) {
+                                error(out, e.what());
+                            }
+                        }
+                    });
+                } catch (const std::exception& e) {
+                    out.resize(mark); // новая версия не опубликована: все изменения группы отклонены
+                    for (size_t k = i; k < end; ++k) error(out, e.what());
+                }
+            } else {
+                while (end < lines.size()) {
+                    std::string_view command = lines[end].substr(0, lines[end].find('\t'));
+                    if (command == "QUIT" || command == "RELOAD" || isMutation(command)) break;
+                    ++end;
+                }
+                system.read([&](const System& current) {
+                    for (size_t k = i; k < end; ++k) {
+                        split(lines[k]);
+                        try {
+                            handleRead(current, out);
+                        } catch (const std::exception& e) {
+                            error(out, e.what());
+                        }
+                    }
+                });
+            }
+            i = end;
+        }
+        return true;
+    }
+
+    static bool writeAll(int fd, const std::string& data) {
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = ::send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+            if (n < 0 && errno == ENOTSOCK) n = ::write(fd, data.data() + done, data.size() - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+public:
+    static constexpr size_t maxLine = 1 << 16;
+
+    explicit CommandServer(ConcurrentAccessControlSystem<Resource>& s) : system(s) {}
+
+    // Обслуживает одно соединение до конца ввода или команды QUIT.
+    // На слишком длинную строку отвечает одной ошибкой и пропускает ввод до
+    // ее конца, чтобы ответы на следующие запросы не сдвинулись.
+    void serve(int inputFd, int outputFd) {
+        std::vector<char> buffer(maxLine * 2 + 1); // +1 для перевода строки в конце ввода
+        std::vector<std::string_view> lines;
+        std::string out;
+        size_t filled = 0;
+        bool running = true;
+        bool discarding = false; // пропускается остаток слишком длинной строки
+        while (running) {
+            ssize_t n = ::read(inputFd, buffer.data() + filled, buffer.size() - filled);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                if (filled == 0 || discarding) break;
+                buffer[filled++] = '\n'; // последняя строка без перевода строки
+                running = false;
+            } else {
+                filled += static_cast<size_t>(n);
+            }
+
+            size_t start = 0;
+            if (discarding) {
+                const char* newline = static_cast<const char*>(std::memchr(buffer.data(), '\n', filled));
+                if (!newline) {
+                    filled = 0;
+                    continue;
+                }
+                start = static_cast<size_t>(newline - buffer.data()) + 1;
+                discarding = false;
+            }
+            lines.clear();
+            for (size_t i = start; i < filled; ++i) {
+                if (buffer[i] != '\n') continue;
+                size_t end = i > start && buffer[i - 1] == '\r' ? i - 1 : i;
+                if (end > start) lines.emplace_back(buffer.data() + start, end - start);
+                start = i + 1;
+            }
+            running = process(lines, out) && running;
+            std::memmove(buffer.data(), buffer.data() + start, filled - start);
+            filled -= start;
+            if (filled >= buffer.size() - 1) {
+                error(out, "Слишком длинная строка запроса");
+                filled = 0;
+                discarding = true;
+            }
+            if (!out.empty()) {
+                if (!writeAll(outputFd, out)) return;
+                out.clear();
+            }
+        }
+    }
+
+    // Принимает соединения на UNIX-сокете, каждое обслуживается в своем потоке.
+    // Работает, пока stop не станет true (проверяется раз в 100 мс).
+    // Завершившиеся соединения собираются на каждом круге ожидания. При
+    // остановке открытые соединения закрываются через shutdown, чтобы
+    // потоки, ждущие ввода от клиентов, завершились. Дескриптор клиента
+    // закрывает этот поток после join, поэтому shutdown не попадет в чужой.
+    static void listen(ConcurrentAccessControlSystem<Resource>& system, const std::string& path,
+                       const std::atomic<bool>& stop, std::function<void()> ready = nullptr) {
+        sockaddr_un address = {};
+        if (path.size() >= sizeof(address.sun_path)) throw std::runtime_error("Слишком длинный путь к сокету");
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) throw std::runtime_error("Не удалось создать сокет");
+        ::unlink(path.c_str());
+        if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listener, 128) != 0) {
+            ::close(listener);
+            throw std::runtime_error("Не удалось открыть сокет " + path);
+        }
+        if (ready) ready();
+
+        struct Connection {
+            int fd;
+            std::atomic<bool> done{false};
+            std::thread thread;
+        };
+        std::vector<std::unique_ptr<Connection>> connections;
+        auto reap = [&connections](bool all) {
+            for (size_t i = 0; i < connections.size();) {
+                Connection& connection = *connections[i];
+                if (!all && !connection.done.load()) {
+                    ++i;
+                    continue;
+                }
+                connection.thread.join();
+                ::close(connection.fd);
+                connections[i] = std::move(connections.back());
+                connections.pop_back();
+            }
+        };
+        while (!stop.load()) {
+            reap(false);
+            pollfd waiting = {listener, POLLIN, 0};
+            if (::poll(&waiting, 1, 100) <= 0) continue;
+            int client = ::accept(listener, nullptr, nullptr);
+            if (client < 0) continue;
+            auto connection = std::make_unique<Connection>();
+            connection->fd = client;
+            Connection* state = connection.get();
+            connection->thread = std::thread([&system, state] {
+                CommandServer server(system);
+                server.serve(state->fd, state->fd);
+                state->done.store(true);
+            });
+            connections.push_back(std::move(connection));
+        }
+        for (auto& connection : connections) ::shutdown(connection->fd, SHUT_RDWR);
+        reap(true);
+        ::close(listener);
+        ::unlink(path.c_str());
+    }
+};
+
+// Функция для создания пользователя
+std::unique_ptr<User> createUser() {
+    std::cout << "Выберите тип пользователя:\n";
+    std::cout << "1. Студент\n";
+    std::cout << "2. Преподаватель\n";
+    std::cout << "3. Администратор\n";
+    std::cout << "Введите номер: ";
+
+    int type;
+    std::cin >> type;
+    std::cin.ignore();
+
+    std::string name;
+    std::cout << "Введите имя: ";
+    std::getline(std::cin, name);
+
+    int id;
+    std::cout << "Введите ID: ";
+    std::cin >> id;
+    std::cin.ignore();
+
+    try {
+        switch (type) {
+            case 1: {
+                std::string group;
+                std::cout << "Введите группу: ";
+                std::getline(std::cin, group);
+                return std::make_unique<Student>(name, id, group);
+            }
+            case 2: {
+                std::string department;
+                std::cout << "Введите кафедру: ";
+                std::getline(std::cin, department);
+                return std::make_unique<Teacher>(name, id, department);
+            }
+            case 3: {
+                std::string position;
+                std::cout << "Введите должность: ";
+                std::getline(std::cin, position);
+                return std::make_unique<Administrator>(name, id, position);
+            }
+            default:
+                throw InvalidInputException("Неверный тип пользователя");
+        }
+    } catch (const InvalidInputException& e) {
+        std::cerr << "Ошибка: " << e.what() << std::endl;
+        return nullptr;
+    }
 }
 
 // Функция для создания ресурса
@@ -445,139 +4923,1473 @@ Resource createResource() {
     std::cout << "Введите название ресурса: ";
     std::getline(std::cin, name);
 
-    int level;
-    std::cout << "Введите требуемый уровень доступа (1-3): ";
-    std::cin >> level;
-    std::cin.ignore();
+    int level;
+    std::cout << "Введите требуемый уровень доступа (1-3): ";
+    std::cin >> level;
+    std::cin.ignore();
+
+    try {
+        return Resource(name, level);
+    } catch (const InvalidInputException& e) {
+        std::cerr << "Ошибка: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+// Главное меню
+void mainMenu(AccessControlSystem<Resource>& system) {
+    while (true) {
+        std::cout << "\n=== Система контроля доступа университета ===\n";
+        std::cout << "1. Добавить пользователя\n";
+        std::cout << "2. Добавить ресурс\n";
+        std::cout << "3. Показать всех пользователей\n";
+        std::cout << "4. Показать все ресурсы\n";
+        std::cout << "5. Проверить доступ\n";
+        std::cout << "6. Найти пользователя по имени\n";
+        std::cout << "7. Найти пользователя по ID\n";
+        std::cout << "8. Сортировать пользователей по уровню доступа\n";
+        std::cout << "9. Сортировать пользователей по имени\n";
+        std::cout << "10. Сохранить данные в файл\n";
+        std::cout << "11. Загрузить данные из файла\n";
+        std::cout << "12. Сохранить бинарный снимок\n";
+        std::cout << "13. Загрузить бинарный снимок\n";
+        std::cout << "14. Настроить кэш решений\n";
+        std::cout << "15. Статистика кэша решений\n";
+        std::cout << "16. Поиск пользователей по началу имени\n";
+        std::cout << "17. Восстановить из снимка и журнала и вести журнал\n";
+        std::cout << "18. Свернуть журнал в снимок\n";
+        std::cout << "19. Импортировать пользователей из CSV/TSV\n";
+        std::cout << "20. Включить аудит решений о доступе\n";
+        std::cout << "21. Статистика аудита\n";
+        std::cout << "22. Выдать роль пользователю\n";
+        std::cout << "23. Потребовать роль для ресурса\n";
+        std::cout << "24. Доступные пользователю ресурсы\n";
+        std::cout << "25. Сохранить дисковый справочник (B+-дерево)\n";
+        std::cout << "26. Настроить фильтры Блума\n";
+        std::cout << "27. Статистика фильтров Блума\n";
+        std::cout << "0. Выход\n";
+        std::cout << "Выберите действие: ";
+
+        int choice;
+        std::cin >> choice;
+        std::cin.ignore();
+
+        try {
+            switch (choice) {
+                case 1: {
+                    auto user = createUser();
+                    if (user) {
+                        system.addUser(std::move(user));
+                        std::cout << "Пользователь добавлен\n";
+                    }
+                    break;
+                }
+                case 2: {
+                    try {
+                        Resource resource = createResource();
+                        system.addResource(resource);
+                        std::cout << "Ресурс добавлен\n";
+                    } catch (...) {
+                        // Ошибка уже обработана в createResource
+                    }
+                    break;
+                }
+                case 3:
+                    system.displayAllUsers();
+                    break;
+                case 4:
+                    system.displayAllResources();
+                    break;
+                case 5: {
+                    int userId;
+                    std::cout << "Введите ID пользователя: ";
+                    std::cin >> userId;
+                    std::cin.ignore();
+
+                    std::string resourceName;
+                    std::cout << "Введите название ресурса: ";
+                    std::getline(std::cin, resourceName);
+
+                    try {
+                        if (system.checkAccess(userId, resourceName)) {
+                            std::cout << "Доступ разрешен\n";
+                        }
+                    } catch (const AccessDeniedException& e) {
+                        std::cerr << "Ошибка доступа: " << e.what() << std::endl;
+                    } catch (const std::runtime_error& e) {
+                        std::cerr << "Ошибка: " << e.what() << std::endl;
+                    }
+                    break;
+                }
+                case 6: {
+                    std::string name;
+                    std::cout << "Введите имя для поиска: ";
+                    std::getline(std::cin, name);
+                    system.findUserByName(name);
+                    break;
+                }
+                case 7: {
+                    int id;
+                    std::cout << "Введите ID для поиска: ";
+                    std::cin >> id;
+                    std::cin.ignore();
+                    system.findUserById(id);
+                    break;
+                }
+                case 8:
+                    system.sortUsersByAccessLevel();
+                    std::cout << "Пользователи отсортированы по уровню доступа\n";
+                    break;
+                case 9:
+                    system.sortUsersByName();
+                    std::cout << "Пользователи отсортированы по имени\n";
+                    break;
+                case 10: {
+                    std::string filename;
+                    std::cout << "Введите имя файла для сохранения: ";
+                    std::getline(std::cin, filename);
+                    system.saveToFile(filename);
+                    std::cout << "Данные сохранены в файл " << filename << std::endl;
+                    break;
+                }
+                case 11: {
+                    std::string filename;
+                    std::cout << "Введите имя файла для загрузки: ";
+                    std::getline(std::cin, filename);
+                    system.loadFromFile(filename);
+                    std::cout << "Данные загружены из файла " << filename << std::endl;
+                    break;
+                }
+                case 12: {
+                    std::string filename;
+                    std::cout << "Введите имя файла снимка: ";
+                    std::getline(std::cin, filename);
+                    system.saveSnapshot(filename);
+                    std::cout << "Снимок сохранен в файл " << filename << std::endl;
+                    break;
+                }
+                case 13: {
+                    std::string filename;
+                    std::cout << "Введите имя файла снимка: ";
+                    std::getline(std::cin, filename);
+                    system.loadSnapshot(filename);
+                    std::cout << "Снимок загружен из файла " << filename << std::endl;
+                    break;
+                }
+                case 14: {
+                    size_t capacity;
+                    std::cout << "Введите размер кэша (0 - выключить): ";
+                    std::cin >> capacity;
+                    std::cin.ignore();
+                    system.setDecisionCacheCapacity(capacity);
+                    std::cout << "Кэш решений настроен\n";
+                    break;
+                }
+                case 15: {
+                    DecisionCache::Stats stats = system.decisionCacheStats();
+                    std::cout << "Записей: " << stats.size << " из " << stats.capacity
+                              << ", попаданий: " << stats.hits << ", промахов: " << stats.misses
+                              << ", вытеснений: " << stats.evictions
+                              << ", инвалидаций: " << stats.invalidations << "\n";
+                    break;
+                }
+                case 16: {
+                    std::string prefix;
+                    std::cout << "Введите начало имени или фамилии: ";
+                    std::getline(std::cin, prefix);
+                    auto found = system.findUsersByWordPrefix(prefix);
+                    for (const User* user : found) user->displayInfo();
+                    if (found.empty()) std::cout << "Пользователи не найдены\n";
+                    break;
+                }
+                case 17: {
+                    std::string snapshotFile, journalFile;
+                    std::cout << "Введите имя файла снимка: ";
+                    std::getline(std::cin, snapshotFile);
+                    std::cout << "Введите имя файла журнала: ";
+                    std::getline(std::cin, journalFile);
+                    size_t replayed = system.enableJournal(snapshotFile, journalFile);
+                    std::cout << "Воспроизведено записей журнала: " << replayed << "\n";
+                    break;
+                }
+                case 18:
+                    system.compactJournal();
+                    std::cout << "Журнал свернут в снимок\n";
+                    break;
+                case 19: {
+                    std::string filename;
+                    std::cout << "Введите имя CSV/TSV файла (тип, имя, ID, атрибут): ";
+                    std::getline(std::cin, filename);
+                    std::ifstream in(filename);
+                    if (!in) throw std::runtime_error("Не удалось открыть файл для чтения");
+                    ImportReport report = system.importUsers(in);
+                    if (!report.errors.empty()) {
+                        std::cout << "Импорт отменен, ошибок: " << report.errors.size() << "\n";
+                        for (size_t i = 0; i < report.errors.size() && i < 20; ++i) {
+                            std::cout << "Строка " << report.errors[i].line << ": " << report.errors[i].message << "\n";
+                        }
+                        break;
+                    }
+                    std::cout << "Импортировано пользователей: " << report.imported << " за " << report.seconds
+                              << " с (" << static_cast<long long>(report.recordsPerSecond) << " записей/с)\n";
+                    break;
+                }
+                case 20: {
+                    std::string filename;
+                    std::cout << "Введите имя файла аудита: ";
+                    std::getline(std::cin, filename);
+                    system.enableAudit(filename);
+                    std::cout << "Аудит включен, расшифровка: --decode-audit " << filename << " [файл данных]\n";
+                    break;
+                }
+                case 21: {
+                    system.flushAudit();
+                    AuditTrail::Stats stats = system.auditStats();
+                    std::cout << "Решений: " << stats.recorded << ", записано: " << stats.written
+                              << ", отброшено: " << stats.dropped << ", потоков: " << stats.threads << "\n";
+                    break;
+                }
+                case 22: {
+                    int id;
+                    unsigned role;
+                    std::cout << "Введите ID пользователя: ";
+                    std::cin >> id;
+                    std::cout << "Введите номер роли (" << RoleMask::firstCustomRole << "-" << RoleMask::bits - 1 << "): ";
+                    std::cin >> role;
+                    std::cin.ignore();
+                    User* user = system.getUser(id);
+                    if (!user) throw std::runtime_error("Пользователь с ID " + std::to_string(id) + " не найден");
+                    user->grantRole(role);
+                    std::cout << "Роль выдана\n";
+                    break;
+                }
+                case 23: {
+                    std::string name;
+                    unsigned role;
+                    std::cout << "Введите название ресурса: ";
+                    std::getline(std::cin, name);
+                    std::cout << "Введите номер роли (" << RoleMask::firstCustomRole << "-" << RoleMask::bits - 1 << "): ";
+                    std::cin >> role;
+                    std::cin.ignore();
+                    Resource* resource = system.getResource(name);
+                    if (!resource) throw std::runtime_error("Ресурс с именем " + name + " не найден");
+                    resource->requireRole(role);
+                    std::cout << "Роль требуется для доступа\n";
+                    break;
+                }
+                case 24: {
+                    int id;
+                    std::cout << "Введите ID пользователя: ";
+                    std::cin >> id;
+                    std::cin.ignore();
+                    auto reachable = system.reachableResources(id);
+                    for (const auto* resource : reachable) resource->displayInfo();
+                    if (reachable.empty()) std::cout << "Доступных ресурсов нет\n";
+                    break;
+                }
+                case 25: {
+                    std::string filename;
+                    std::cout << "Введите имя файла дискового справочника: ";
+                    std::getline(std::cin, filename);
+                    system.saveDiskDirectory(filename);
+                    std::cout << "Дисковый справочник сохранен в файл " << filename << std::endl;
+                    break;
+                }
+                case 26: {
+                    double rate;
+                    std::cout << "Доля ложных срабатываний (0 - выключить): ";
+                    std::cin >> rate;
+                    std::cin.ignore();
+                    system.setBloomFilters(rate);
+                    std::cout << (rate > 0 ? "Фильтры Блума включены\n" : "Фильтры Блума выключены\n");
+                    break;
+                }
+                case 27: {
+                    auto show = [](const char* label, const BloomFilter::Stats& stats) {
+                        std::cout << label << ": ключей " << stats.keys << " (расчет на " << stats.capacity
+                                  << "), бит " << stats.bits << ", хэш-функций " << stats.hashes
+                                  << ", отсеяно " << stats.rejected << ", ложных срабатываний "
+                                  << stats.falsePositives << "\n";
+                    };
+                    show("Пользователи", system.userFilterStats());
+                    show("Ресурсы", system.resourceFilterStats());
+                    break;
+                }
+                case 0:
+                    return;
+                default:
+                    std::cout << "Неверный выбор\n";
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+        }
+    }
+}
+
+// Детерминированный синтетический справочник для замеров производительности
+void generateSyntheticDirectory(AccessControlSystem<Resource>& system, size_t userCount,
+                                size_t resourceCount, unsigned seed) {
+    static const char* surnames[] = {"Иванов", "Петров", "Сидоров", "Смирнов", "Кузнецов",
+                                     "Попов", "Васильев", "Соколов", "Михайлов", "Новиков"};
+    static const char* firstNames[] = {"Иван", "Петр", "Мария", "Анна", "Сергей",
+                                       "Ольга", "Дмитрий", "Елена", "Алексей", "Наталья"};
+    static const char* departments[] = {"Компьютерные науки", "Прикладная математика",
+                                        "Физика", "Иностранные языки", "Экономика"};
+    static const char* positions[] = {"Начальник отдела", "Инженер", "Методист", "Проректор"};
+
+    std::mt19937 rng(seed);
+    for (size_t i = 0; i < userCount; ++i) {
+        int id = static_cast<int>(i) + 1;
+        std::string name = std::string(surnames[rng() % 10]) + " " + firstNames[rng() % 10];
+        unsigned kind = rng() % 100;
+        if (kind < 85) {
+            system.addUser(std::make_unique<Student>(name, id, "ИТ-" + std::to_string(100 + rng() % 2000)));
+        } else if (kind < 97) {
+            system.addUser(std::make_unique<Teacher>(name, id, departments[rng() % 5]));
+        } else {
+            system.addUser(std::make_unique<Administrator>(name, id, positions[rng() % 4]));
+        }
+    }
+    for (size_t i = 0; i < resourceCount; ++i) {
+        system.addResource(Resource("Аудитория " + std::to_string(i + 1), 1 + rng() % 3));
+    }
+}
+
+// Сравнение пакетной проверки с циклом одиночных вызовов при 1, 2, 4 и 8 потоках
+void benchmarkBatchAccess(size_t userCount, size_t resourceCount, size_t queryCount) {
+    if (userCount == 0 || resourceCount == 0) {
+        throw InvalidInputException("Число пользователей и ресурсов должно быть больше нуля");
+    }
+    using Clock = std::chrono::steady_clock;
+    const size_t batchSize = 4096;
+
+    AccessControlSystem<Resource> system;
+    generateSyntheticDirectory(system, userCount, resourceCount, 42);
+
+    // 2% запросов - к несуществующим пользователям или ресурсам
+    std::mt19937 rng(7);
+    std::vector<AccessQuery> queries(queryCount);
+    for (auto& query : queries) {
+        query.userId = 1 + static_cast<int>(rng() % (userCount + userCount / 50));
+        query.resourceName = "Аудитория " + std::to_string(1 + rng() % (resourceCount + resourceCount / 50));
+    }
+
+    auto report = [&](const std::string& label, Clock::duration elapsed, size_t allowed) {
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        std::cout << label << ": " << static_cast<long long>(queryCount / seconds)
+                  << " проверок/с (разрешено " << allowed << ")\n";
+    };
+
+    auto start = Clock::now();
+    size_t allowed = 0;
+    for (const auto& query : queries) {
+        try {
+            allowed += system.checkAccess(query.userId, query.resourceName);
+        } catch (const std::runtime_error&) {
+        }
+    }
+    report("checkAccess в цикле", Clock::now() - start, allowed);
+
+    start = Clock::now();
+    allowed = 0;
+    for (const auto& query : queries) {
+        allowed += system.decideAccess(query.userId, query.resourceName) == AccessDecision::Allowed;
+    }
+    report("decideAccess в цикле", Clock::now() - start, allowed);
+
+    std::vector<AccessDecision> results(queryCount);
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        system.setWorkerThreads(threads);
+        start = Clock::now();
+        for (size_t offset = 0; offset < queryCount; offset += batchSize) {
+            size_t count = std::min(batchSize, queryCount - offset);
+            system.decideAccessBatch(&queries[offset], count, &results[offset]);
+        }
+        allowed = std::count(results.begin(), results.end(), AccessDecision::Allowed);
+        report("decideAccessBatch, потоков: " + std::to_string(threads), Clock::now() - start, allowed);
+    }
+}
+
+// Нагрузочная проверка ConcurrentAccessControlSystem: читатели непрерывно проверяют
+// доступ, пока писатель добавляет пользователей, меняет ресурс и сортирует список.
+// Исходные пользователи и ресурсы не удаляются, поэтому читатель не должен
+// ни разу получить UnknownUser или UnknownResource.
+void benchmarkConcurrentAccess(size_t userCount, size_t resourceCount, double seconds) {
+    if (userCount == 0 || resourceCount == 0) {
+        throw InvalidInputException("Число пользователей и ресурсов должно быть больше нуля");
+    }
+    using Clock = std::chrono::steady_clock;
+
+    for (unsigned readers : {1u, 2u, 4u, 8u}) {
+        ConcurrentAccessControlSystem<Resource> system;
+        system.update([&](AccessControlSystem<Resource>& s) {
+            generateSyntheticDirectory(s, userCount, resourceCount, 42);
+            s.addResource(Resource("Переменный ресурс", 1));
+        });
+
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> checks{0}, violations{0};
+        std::vector<std::string> names(resourceCount);
+        for (size_t i = 0; i < resourceCount; ++i) names[i] = "Аудитория " + std::to_string(i + 1);
+
+        std::vector<std::thread> threads;
+        for (unsigned r = 0; r < readers; ++r) {
+            threads.emplace_back([&, r] {
+                std::mt19937 rng(r + 1);
+                uint64_t local = 0, bad = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (int k = 0; k < 256; ++k) {
+                        int id = 1 + static_cast<int>(rng() % userCount);
+                        AccessDecision d = system.decideAccess(id, names[rng() % resourceCount]);
+                        bad += d == AccessDecision::UnknownUser || d == AccessDecision::UnknownResource;
+                    }
+                    local += 256;
+                }
+                checks += local;
+                violations += bad;
+            });
+        }
+
+        int nextId = static_cast<int>(userCount) + 1;
+        auto start = Clock::now();
+        while (std::chrono::duration<double>(Clock::now() - start).count() < seconds) {
+            system.update([&](AccessControlSystem<Resource>& s) {
+                s.addUser(std::make_unique<Student>("Новый Студент", nextId++, "ИТ-999"));
+                Resource* resource = s.getResource("Переменный ресурс");
+                resource->setRequiredAccessLevel(resource->getRequiredAccessLevel() % 3 + 1);
+            });
+            system.sortUsersByName();
+        }
+        stop = true;
+        for (auto& thread : threads) thread.join();
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        system.reclaim();
+
+        std::cout << "Читателей: " << readers << ", проверок/с: "
+                  << static_cast<long long>(checks / elapsed)
+                  << ", версий опубликовано: " << system.publishedVersions()
+                  << ", не освобождено: " << system.pendingVersions()
+                  << ", нарушений: " << violations << "\n";
+    }
+}
+
+// Перезагрузка справочника из файла под нагрузкой: время сборки и публикации
+// новой версии и задержка проверок у читателей. Наибольшая задержка во время
+// перезагрузок сравнивается с наибольшей задержкой без них.
+void benchmarkReload(size_t userCount, size_t resourceCount, unsigned readers, int reloads) {
+    if (userCount == 0 || resourceCount == 0) {
+        throw InvalidInputException("Число пользователей и ресурсов должно быть больше нуля");
+    }
+    using Clock = std::chrono::steady_clock;
+    const std::string filename = "reload_benchmark.txt";
+    {
+        AccessControlSystem<Resource> source;
+        generateSyntheticDirectory(source, userCount, resourceCount, 42);
+        source.saveToFile(filename);
+    }
+    ConcurrentAccessControlSystem<Resource> system;
+    system.reloadFromFile(filename);
+
+    std::vector<std::string> names(resourceCount);
+    for (size_t i = 0; i < resourceCount; ++i) names[i] = "Аудитория " + std::to_string(i + 1);
+
+    std::atomic<bool> stop{false}, reloading{false};
+    std::atomic<uint64_t> checks{0}, unknown{0};
+    std::atomic<int64_t> idleMaxNs{0}, reloadMaxNs{0};
+    auto raise = [](std::atomic<int64_t>& target, int64_t value) {
+        int64_t seen = target.load(std::memory_order_relaxed);
+        while (value > seen && !target.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            std::mt19937 rng(r + 1);
+            uint64_t local = 0, bad = 0;
+            int64_t idleMax = 0, reloadMax = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                int id = 1 + static_cast<int>(rng() % userCount);
+                const std::string& name = names[rng() % resourceCount];
+                bool during = reloading.load(std::memory_order_relaxed);
+                auto start = Clock::now();
+                AccessDecision d = system.decideAccess(id, name);
+                int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+                int64_t& max = during ? reloadMax : idleMax;
+                max = std::max(max, ns);
+                bad += d == AccessDecision::UnknownUser || d == AccessDecision::UnknownResource;
+                ++local;
+            }
+            checks += local;
+            unknown += bad;
+            raise(idleMaxNs, idleMax);
+            raise(reloadMaxNs, reloadMax);
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    double build = 0, publish = 0, reclaim = 0, worstBuild = 0;
+    int freed = 0;
+    for (int i = 0; i < reloads; ++i) {
+        reloading = true;
+        auto stats = system.reloadFromFile(filename);
+        reloading = false;
+        build += stats.buildSeconds;
+        publish += stats.publishSeconds;
+        reclaim += stats.reclaimSeconds;
+        worstBuild = std::max(worstBuild, stats.buildSeconds);
+        freed += stats.oldVersionFreed;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    stop = true;
+    for (auto& thread : threads) thread.join();
+    std::remove(filename.c_str());
+
+    std::printf("Читателей: %u, перезагрузок: %d, проверок: %llu, неизвестных: %llu\n", readers, reloads,
+                static_cast<unsigned long long>(checks.load()), static_cast<unsigned long long>(unknown.load()));
+    std::printf("Сборка: среднее %.1f мс, максимум %.1f мс; публикация: среднее %.3f мкс; "
+                "освобождение старой версии: среднее %.3f мс (освобождено %d из %d)\n",
+                build / reloads * 1e3, worstBuild * 1e3, publish / reloads * 1e6, reclaim / reloads * 1e3, freed,
+                reloads);
+    std::printf("Наибольшая задержка проверки: без перезагрузки %.1f мкс, во время перезагрузки %.1f мкс\n",
+                idleMaxNs.load() / 1e3, reloadMaxNs.load() / 1e3);
+}
+
+// Дисковый справочник: задержка поиска по ID, по имени и проверки доступа
+// с холодным кэшем (пул буферов и страничный кэш ОС сброшены перед каждым
+// поиском) и с прогретым пулом заданного размера
+void benchmarkDiskDirectory(size_t userCount, size_t resourceCount, size_t cacheMb, size_t samples) {
+    if (userCount == 0 || resourceCount == 0) {
+        throw InvalidInputException("Число пользователей и ресурсов должно быть больше нуля");
+    }
+    using Clock = std::chrono::steady_clock;
+    const std::string filename = "disk_directory_benchmark.bin";
+    std::vector<std::string> userNames, resourceNames;
+    {
+        AccessControlSystem<Resource> source;
+        generateSyntheticDirectory(source, userCount, resourceCount, 42);
+        source.forEachUser([&](const User& user) {
+            if (userNames.size() < 4096) userNames.push_back(user.getName());
+        });
+        source.forEachResource([&](const Resource& resource) { resourceNames.push_back(resource.getName()); });
+        auto start = Clock::now();
+        source.saveDiskDirectory(filename);
+        std::printf("Файл записан за %.2f с\n", std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    DiskDirectory directory(filename, cacheMb << 20);
+    BufferPool::Stats initial = directory.cacheStats();
+    std::printf("Пользователей: %zu, ресурсов: %zu, файл: %.1f МБ, пул: %zu страниц (%.1f МБ)\n",
+                directory.userCount(), directory.resourceCount(), directory.fileBytes() / 1048576.0, initial.frames,
+                initial.frames * btree::pageSize / 1048576.0);
+
+    std::mt19937 rng(7);
+    auto run = [&](const std::string& label, bool cold, const std::function<void()>& op) {
+        std::vector<double> latencies(samples);
+        BufferPool::Stats before = directory.cacheStats();
+        for (size_t i = 0; i < samples; ++i) {
+            if (cold) directory.dropCaches();
+            auto start = Clock::now();
+            op();
+            latencies[i] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        }
+        BufferPool::Stats after = directory.cacheStats();
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) { return latencies[std::min(size_t(p * samples), samples - 1)]; };
+        std::printf("%-34s p50 %8.2f мкс, p99 %8.2f мкс, страниц с диска на поиск: %.2f\n", label.c_str(),
+                    percentile(0.50), percentile(0.99), double(after.misses - before.misses) / samples);
+    };
+
+    auto byId = [&] { directory.getUser(1 + static_cast<int>(rng() % userCount)); };
+    auto byName = [&] { directory.findUsersByName(userNames[rng() % userNames.size()], 1); };
+    auto decide = [&] {
+        directory.decideAccess(1 + static_cast<int>(rng() % userCount), resourceNames[rng() % resourceNames.size()]);
+    };
+    run("getUser, холодный кэш", true, byId);
+    run("findUsersByName, холодный кэш", true, byName);
+    run("decideAccess, холодный кэш", true, decide);
+    for (size_t i = 0; i < samples * 4; ++i) decide(); // прогрев
+    run("getUser, прогретый кэш", false, byId);
+    run("findUsersByName, прогретый кэш", false, byName);
+    run("decideAccess, прогретый кэш", false, decide);
+
+    BufferPool::Stats stats = directory.cacheStats();
+    std::printf("Попаданий: %llu, чтений с диска: %llu, вытеснений: %llu\n",
+                static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+                static_cast<unsigned long long>(stats.evictions));
+    std::remove(filename.c_str());
+}
+
+// Фильтры Блума: проверки, где доля probeShare запросов приходится на
+// несуществующие ID или названия (сканеры), без фильтров и с фильтрами,
+// без кэша решений и с кэшем (отсеянные запросы не берут его мьютекс и не
+// вытесняют из него решения). Для дискового справочника выводится число
+// обращений к пулу буферов и чтений страниц на запрос.
+void benchmarkBloomFilters(size_t userCount, size_t resourceCount, size_t queryCount, double probeShare) {
+    if (userCount == 0 || resourceCount == 0) {
+        throw InvalidInputException("Число пользователей и ресурсов должно быть больше нуля");
+    }
+    using Clock = std::chrono::steady_clock;
+    AccessControlSystem<Resource> system;
+    generateSyntheticDirectory(system, userCount, resourceCount, 42);
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> share(0, 1);
+    std::vector<AccessQuery> queries(queryCount);
+    size_t probes = 0;
+    for (auto& query : queries) {
+        bool probe = share(rng) < probeShare;
+        probes += probe;
+        bool unknownUser = probe && rng() % 2 == 0;
+        bool unknownResource = probe && !unknownUser;
+        query.userId = unknownUser ? static_cast<int>(userCount + 1 + rng() % 1000000000)
+                                   : 1 + static_cast<int>(rng() % userCount);
+        query.resourceName = unknownResource ? "Скан " + std::to_string(rng())
+                                             : "Аудитория " + std::to_string(1 + rng() % resourceCount);
+    }
+    std::printf("Пользователей: %zu, ресурсов: %zu, запросов: %zu, из них к несуществующим: %zu\n", userCount,
+                resourceCount, queryCount, probes);
+
+    auto run = [&](double rate, size_t cacheCapacity) {
+        system.setBloomFilters(rate);
+        system.setDecisionCacheCapacity(cacheCapacity);
+        auto start = Clock::now();
+        for (const auto& query : queries) system.decideAccess(query.userId, query.resourceName);
+        double decide = std::chrono::duration<double>(Clock::now() - start).count();
+        start = Clock::now();
+        for (const auto& query : queries) {
+            try {
+                system.checkAccess(query.userId, query.resourceName);
+            } catch (const std::exception&) {
+                // отказ - тоже результат проверки
+            }
+        }
+        double check = std::chrono::duration<double>(Clock::now() - start).count();
+        BloomFilter::Stats users = system.userFilterStats(), resources = system.resourceFilterStats();
+        std::printf("Доля ложных срабатываний %-6g кэш %-7zu decideAccess: %10.0f/с, checkAccess: %10.0f/с", rate,
+                    cacheCapacity, queryCount / decide, queryCount / check);
+        if (rate > 0) {
+            std::printf(", отсеяно: %llu, ложных срабатываний: %llu, бит на ключ: %.1f",
+                        static_cast<unsigned long long>(users.rejected + resources.rejected),
+                        static_cast<unsigned long long>(users.falsePositives + resources.falsePositives),
+                        double(users.bits + resources.bits) / std::max<size_t>(1, users.keys + resources.keys));
+        }
+        std::printf("\n");
+    };
+    for (size_t cacheCapacity : {size_t(0), size_t(100000)}) {
+        run(0, cacheCapacity);
+        run(0.01, cacheCapacity);
+        run(0.001, cacheCapacity);
+    }
+    system.setBloomFilters(0);
+    system.setDecisionCacheCapacity(0);
+
+    const std::string filename = "bloom_benchmark.bin";
+    system.saveDiskDirectory(filename);
+    for (double rate : {0.0, 0.01}) {
+        DiskDirectory directory(filename, size_t(1) << 20, rate);
+        auto start = Clock::now();
+        for (const auto& query : queries) directory.decideAccess(query.userId, query.resourceName);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        BufferPool::Stats stats = directory.cacheStats();
+        std::printf("Дисковый справочник, доля %-6g decideAccess: %10.0f/с, обращений к пулу на запрос: %.2f, "
+                    "чтений страниц: %.2f\n", rate, queryCount / seconds,
+                    double(stats.hits + stats.misses) / queryCount, double(stats.misses) / queryCount);
+    }
+    std::remove(filename.c_str());
+}
+
+// Журнал изменений: скорость записи изменений с групповой фиксацией,
+// время сжатия в снимок и время восстановления (снимок + журнал)
+void benchmarkJournal(size_t userCount, size_t changeCount) {
+    if (userCount == 0) throw InvalidInputException("Число пользователей должно быть больше нуля");
+    using Clock = std::chrono::steady_clock;
+    const std::string snapshotFile = "bench_journal.snapshot";
+    const std::string journalFile = "bench_journal.log";
+    std::remove(snapshotFile.c_str());
+    std::remove(journalFile.c_str());
+    auto seconds = [](Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+
+    Journal::Options options;
+    options.compactAfterBytes = 0;
+    AccessControlSystem<Resource> system;
+    system.enableJournal(snapshotFile, journalFile, options);
+    {
+        AccessControlSystem<Resource> generated;
+        generateSyntheticDirectory(generated, userCount, userCount / 10, 42);
+        generated.saveSnapshot(snapshotFile);
+    }
+    system.enableJournal(snapshotFile, journalFile, options);
+
+    // Смесь изменений: новые пользователи и смена уровней доступа
+    auto applyChanges = [&](int firstNewId) {
+        std::mt19937 rng(1);
+        auto start = Clock::now();
+        for (size_t i = 0; i < changeCount; ++i) {
+            if (i % 2 == 0) {
+                system.addUser(std::make_unique<Student>("Новый Студент", firstNewId + static_cast<int>(i), "ИТ-777"));
+            } else {
+                system.getUser(1 + static_cast<int>(rng() % userCount))->setAccessLevel(1 + rng() % 3);
+            }
+        }
+        system.commitJournal();
+        return seconds(start);
+    };
+
+    double elapsed = applyChanges(static_cast<int>(userCount) + 1);
+    Journal::Stats stats = system.journalStats();
+    std::cout << "Изменений: " << changeCount << ", " << static_cast<long long>(changeCount / elapsed)
+              << " изменений/с, fdatasync: " << stats.commits
+              << ", размер журнала: " << stats.fileBytes << " байт\n";
+
+    auto start = Clock::now();
+    AccessControlSystem<Resource> recovered;
+    size_t replayed = recovered.enableJournal(snapshotFile, journalFile, options);
+    std::cout << "Восстановление (снимок " << userCount << " + журнал " << replayed << " записей): "
+              << seconds(start) << " с, пользователей: " << recovered.userCount() << "\n";
+
+    start = Clock::now();
+    system.compactJournal();
+    std::cout << "Сжатие журнала в снимок: " << seconds(start) << " с\n";
+
+    start = Clock::now();
+    AccessControlSystem<Resource> fromSnapshot;
+    fromSnapshot.enableJournal(snapshotFile, journalFile, options);
+    std::cout << "Восстановление после сжатия: " << seconds(start) << " с, пользователей: "
+              << fromSnapshot.userCount() << "\n";
+
+    std::remove(snapshotFile.c_str());
+    std::remove(journalFile.c_str());
+}
+
+// Объем памяти, выделенной из кучи, включая крупные блоки через mmap (по данным glibc)
+size_t heapInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+// Сравнение объектного и колоночного хранения: память на пользователя и
+// скорость сканирования "все ID с уровнем >= k на кафедре D" и подсчета по уровням
+void benchmarkColumnarStore(size_t userCount) {
+    if (userCount == 0) throw InvalidInputException("Число пользователей должно быть больше нуля");
+    using Clock = std::chrono::steady_clock;
+    const int repeats = 20;
+    const std::string department = "Компьютерные науки";
+
+    size_t before = heapInUse();
+    AccessControlSystem<Resource> system;
+    generateSyntheticDirectory(system, userCount, 0, 42);
+    size_t systemBytes = heapInUse() - before;
+
+    before = heapInUse();
+    ColumnarUserStore store = system.buildColumnarStore();
+    size_t storeBytes = heapInUse() - before;
+
+    std::cout << "Пользователей: " << userCount << "\n";
+    std::cout << "Система (объекты, индексы и представления): " << systemBytes / userCount << " байт/пользователь\n";
+    std::cout << "Колоночное хранилище: " << storeBytes / userCount << " байт/пользователь\n";
+
+    auto measure = [&](const std::string& label, const std::function<size_t()>& scan) {
+        size_t result = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < repeats; ++i) result += scan();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << label << ": " << static_cast<long long>(userCount * repeats / seconds / 1e6)
+                  << " млн строк/с (результат " << result / repeats << ")\n";
+    };
+
+    measure("Фильтр, объекты", [&] {
+        std::vector<int> found;
+        system.forEachUser([&](const User& user) {
+            if (user.getAccessLevel() >= 2 && user.getAttribute() == department) found.push_back(user.getId());
+        });
+        return found.size();
+    });
+    measure("Фильтр, колонки", [&] { return store.idsWithLevelAtLeast(2, department).size(); });
+    measure("Подсчет по уровням, объекты", [&] {
+        std::array<size_t, 4> counts = {};
+        system.forEachUser([&](const User& user) { ++counts[user.getAccessLevel()]; });
+        return counts[1];
+    });
+    measure("Подсчет по уровням, колонки", [&] { return store.countByAccessLevel()[1]; });
+}
+
+// Импорт CSV в сравнении с поштучным addUser
+void benchmarkImport(size_t userCount) {
+    using Clock = std::chrono::steady_clock;
+    static const char* types[] = {"Student", "Teacher", "Administrator"};
+    std::string csv = "type,name,id,attribute\n";
+    for (size_t i = 0; i < userCount; ++i) {
+        const char* type = types[i % 10 == 0 ? 1 + (i / 10) % 2 : 0];
+        csv += type;
+        csv += ",\"Студент " + std::to_string(i) + ", поток " + std::to_string(i % 7) + "\"," +
+               std::to_string(i + 1) + ",ИТ-" + std::to_string(100 + i % 300) + "\n";
+    }
+
+    std::istringstream in(csv);
+    AccessControlSystem<Resource> bulk;
+    bulk.setWorkerThreads(std::max(1u, std::thread::hardware_concurrency()));
+    ImportReport report = bulk.importUsers(in, userCount);
+    if (!report.errors.empty()) {
+        std::cout << "Ошибка импорта: " << report.errors.front().message << "\n";
+        return;
+    }
+
+    AccessControlSystem<Resource> single;
+    auto start = Clock::now();
+    for (size_t i = 0; i < userCount; ++i) {
+        const User& user = *bulk.getUser(static_cast<int>(i + 1));
+        single.addUser(makeUser(user.getKind(), user.getName(), user.getId(), user.getAttribute()));
+    }
+    double singleSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "Пользователей: " << userCount << ", байт CSV: " << csv.size() << "\n";
+    std::cout << "importUsers (разбор CSV и вставка): " << static_cast<long long>(report.recordsPerSecond)
+              << " записей/с\n";
+    std::cout << "addUser по одному (без разбора): " << static_cast<long long>(userCount / singleSeconds)
+              << " записей/с\n";
+}
 
-    try {
-        return Resource(name, level);
-    } catch (const InvalidInputException& e) {
-        std::cerr << "Ошибка: " << e.what() << std::endl;
-        throw;
+// Память атрибутов: отдельная std::string в каждом пользователе против номеров
+// AttributePool, и скорость фильтра по атрибуту
+void benchmarkInterning(size_t userCount) {
+    if (userCount == 0) throw InvalidInputException("Число пользователей должно быть больше нуля");
+    using Clock = std::chrono::steady_clock;
+    static const char* faculties[] = {"Информационные технологии", "Прикладная математика", "Физика",
+                                      "Экономика", "Иностранные языки"};
+    // ~2 тыс. групп на 300 тыс. студентов, как в реальном справочнике
+    std::mt19937 rng(42);
+    std::vector<std::string> source(userCount);
+    for (auto& value : source) {
+        unsigned group = rng() % 2000;
+        value = std::string(faculties[group % 5]) + ", группа " + std::to_string(100 + group);
+    }
+
+    size_t before = heapInUse();
+    std::vector<std::string> strings(source.begin(), source.end());
+    size_t stringBytes = heapInUse() - before;
+
+    size_t poolBefore = AttributePool::instance().memoryUsage();
+    before = heapInUse();
+    std::vector<InternedString> interned;
+    interned.reserve(userCount);
+    for (const auto& value : source) interned.emplace_back(value);
+    size_t internedBytes = heapInUse() - before;
+    size_t poolBytes = AttributePool::instance().memoryUsage() - poolBefore;
+
+    std::cout << "Пользователей: " << userCount << ", различных атрибутов: " << AttributePool::instance().size() - 1
+              << "\n";
+    std::cout << "std::string в каждом пользователе: " << stringBytes << " байт ("
+              << stringBytes / std::max<size_t>(userCount, 1) << " байт/пользователь)\n";
+    std::cout << "Номера и пул: " << internedBytes << " байт (пул " << poolBytes << ")\n";
+    if (stringBytes > internedBytes) {
+        std::cout << "Экономия: " << (stringBytes - internedBytes) / 1024 << " КБ ("
+                  << 100 * (stringBytes - internedBytes) / stringBytes << "%)\n";
     }
+
+    const std::string& target = source[userCount / 2];
+    auto start = Clock::now();
+    size_t byString = 0;
+    for (const auto& value : strings) byString += value == target;
+    double stringSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    start = Clock::now();
+    uint32_t targetId = 0;
+    AttributePool::instance().find(target, targetId);
+    size_t byId = 0;
+    for (const auto& value : interned) byId += value.getId() == targetId;
+    double idSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Фильтр по строкам: " << stringSeconds * 1e3 << " мс, по номерам: " << idSeconds * 1e3
+              << " мс (найдено " << byString << "/" << byId << ")\n";
 }
 
-// Главное меню
-void mainMenu(AccessControlSystem<Resource>& system) {
-    while (true) {
-        std::cout << "\n=== Система контроля доступа университета ===\n";
-        std::cout << "1. Добавить пользователя\n";
-        std::cout << "2. Добавить ресурс\n";
-        std::cout << "3. Показать всех пользователей\n";
-        std::cout << "4. Показать все ресурсы\n";
-        std::cout << "5. Проверить доступ\n";
-        std::cout << "6. Найти пользователя по имени\n";
-        std::cout << "7. Найти пользователя по ID\n";
-        std::cout << "8. Сортировать пользователей по уровню доступа\n";
-        std::cout << "9. Сортировать пользователей по имени\n";
-        std::cout << "10. Сохранить данные в файл\n";
-        std::cout << "11. Загрузить данные из файла\n";
-        std::cout << "0. Выход\n";
-        std::cout << "Выберите действие: ";
+// Запрос "какие ресурсы доступны пользователю": проход по маскам ролей против
+// вызова checkAccess для каждого ресурса
+void benchmarkRoles(size_t userCount, size_t resourceCount) {
+    if (userCount == 0) throw InvalidInputException("Число пользователей должно быть больше нуля");
+    using Clock = std::chrono::steady_clock;
+    const size_t queries = std::min<size_t>(userCount, 2000);
+    AccessControlSystem<Resource> system;
+    generateSyntheticDirectory(system, userCount, resourceCount, 42);
 
-        int choice;
-        std::cin >> choice;
-        std::cin.ignore();
+    // Треть ресурсов требует особую роль, у пользователей до четырех ролей
+    std::mt19937 rng(7);
+    std::vector<std::string> names;
+    system.forEachResource([&](const Resource& resource) { names.push_back(resource.getName()); });
+    for (const auto& name : names) {
+        if (rng() % 3 == 0) system.getResource(name)->requireRole(RoleMask::firstCustomRole + rng() % 16);
+    }
+    for (size_t id = 1; id <= userCount; ++id) {
+        User* user = system.getUser(static_cast<int>(id));
+        for (unsigned k = rng() % 5; k > 0; --k) user->grantRole(RoleMask::firstCustomRole + rng() % 16);
+    }
 
-        try {
-            switch (choice) {
-                case 1: {
-                    auto user = createUser();
-                    if (user) {
-                        system.addUser(std::move(user));
-                        std::cout << "Пользователь добавлен\n";
+    size_t byMasks = 0, byCheck = 0;
+    auto start = Clock::now();
+    for (size_t q = 0; q < queries; ++q) byMasks += system.countReachableResources(static_cast<int>(q + 1));
+    double maskSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (size_t q = 0; q < queries; ++q) {
+        const User& user = *system.getUser(static_cast<int>(q + 1));
+        system.forEachResource([&](const Resource& resource) { byCheck += resource.checkAccess(user); });
+    }
+    double checkSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+#ifdef __SSE2__
+    const char* mode = "SSE2";
+#else
+    const char* mode = "скалярный";
+#endif
+    std::cout << "Пользователей: " << userCount << ", ресурсов: " << resourceCount << ", запросов: " << queries << "\n";
+    std::cout << "Маски ролей (" << mode << "): " << maskSeconds / queries * 1e6 << " мкс/запрос, "
+              << static_cast<long long>(queries * resourceCount / maskSeconds / 1e6) << " млн ресурсов/с\n";
+    std::cout << "checkAccess для каждого ресурса: " << checkSeconds / queries * 1e6 << " мкс/запрос, "
+              << static_cast<long long>(queries * resourceCount / checkSeconds / 1e6) << " млн ресурсов/с\n";
+    std::cout << "Доступно в среднем: " << byMasks / queries << " ресурсов"
+              << (byMasks == byCheck ? "" : " (РЕЗУЛЬТАТЫ РАСХОДЯТСЯ)") << "\n";
+}
+
+// Нагрузка на сервер команд через UNIX-сокет: каждое соединение отправляет
+// запросы пачками по depth штук, не дожидаясь ответов. Задержка запроса -
+// время от отправки пачки до получения его ответа.
+void benchmarkServer(size_t userCount, size_t resourceCount, unsigned connections, size_t requestsPerConnection,
+                     size_t depth) {
+    if (userCount == 0 || resourceCount == 0) {
+        throw InvalidInputException("Число пользователей и ресурсов должно быть больше нуля");
+    }
+    using Clock = std::chrono::steady_clock;
+    const std::string path = "/tmp/acs_benchmark_" + std::to_string(::getpid()) + ".sock";
+    ConcurrentAccessControlSystem<Resource> system;
+    system.update([&](AccessControlSystem<Resource>& next) {
+        generateSyntheticDirectory(next, userCount, resourceCount, 42);
+    });
+
+    std::atomic<bool> stop{false};
+    std::mutex readyMutex;
+    std::condition_variable readyCondition;
+    bool ready = false;
+    std::thread server([&] {
+        CommandServer::listen(system, path, stop, [&] {
+            std::lock_guard<std::mutex> lock(readyMutex);
+            ready = true;
+            readyCondition.notify_one();
+        });
+    });
+    {
+        std::unique_lock<std::mutex> lock(readyMutex);
+        readyCondition.wait(lock, [&] { return ready; });
+    }
+
+    // 90% проверок доступа, 10% поиска пользователя по ID
+    std::vector<std::vector<double>> latencies(connections);
+    auto start = Clock::now();
+    std::vector<std::thread> clients;
+    for (unsigned c = 0; c < connections; ++c) {
+        clients.emplace_back([&, c] {
+            int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un address = {};
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+                if (fd >= 0) ::close(fd);
+                return;
+            }
+            std::mt19937 rng(c + 1);
+            std::string batch;
+            std::vector<char> reply(1 << 16);
+            latencies[c].reserve(requestsPerConnection);
+            for (size_t sent = 0; sent < requestsPerConnection;) {
+                size_t count = std::min(depth, requestsPerConnection - sent);
+                batch.clear();
+                for (size_t k = 0; k < count; ++k) {
+                    int id = 1 + static_cast<int>(rng() % userCount);
+                    if (rng() % 10 == 0) {
+                        batch += "USER\t" + std::to_string(id) + "\n";
+                    } else {
+                        batch += "CHECK\t" + std::to_string(id) + "\tАудитория " +
+                                 std::to_string(1 + rng() % resourceCount) + "\n";
                     }
-                    break;
                 }
-                case 2: {
-                    try {
-                        Resource resource = createResource();
-                        system.addResource(resource);
-                        std::cout << "Ресурс добавлен\n";
-                    } catch (...) {
-                        // Ошибка уже обработана в createResource
-                    }
-                    break;
+                auto sentAt = Clock::now();
+                if (::send(fd, batch.data(), batch.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(batch.size())) break;
+                size_t answered = 0;
+                while (answered < count) {
+                    ssize_t n = ::read(fd, reply.data(), reply.size());
+                    if (n <= 0) break;
+                    auto now = Clock::now();
+                    size_t lines = static_cast<size_t>(std::count(reply.data(), reply.data() + n, '\n'));
+                    double ns = std::chrono::duration<double, std::nano>(now - sentAt).count();
+                    for (size_t k = 0; k < lines; ++k) latencies[c].push_back(ns);
+                    answered += lines;
                 }
-                case 3:
-                    system.displayAllUsers();
-                    break;
-                case 4:
-                    system.displayAllResources();
-                    break;
-                case 5: {
-                    int userId;
-                    std::cout << "Введите ID пользователя: ";
-                    std::cin >> userId;
-                    std::cin.ignore();
+                if (answered < count) break;
+                sent += count;
+            }
+            ::close(fd);
+        });
+    }
+    for (auto& client : clients) client.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stop = true;
+    server.join();
 
-                    std::string resourceName;
-                    std::cout << "Введите название ресурса: ";
-                    std::getline(std::cin, resourceName);
+    std::vector<double> all;
+    for (auto& part : latencies) all.insert(all.end(), part.begin(), part.end());
+    if (all.empty()) {
+        std::cout << "Нет ответов сервера\n";
+        return;
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))] / 1e3; };
+    std::cout << "Соединений: " << connections << ", глубина конвейера: " << depth << ", ответов: " << all.size() << "\n";
+    std::cout << "Запросов/с: " << static_cast<long long>(all.size() / seconds) << "\n";
+    std::cout << "Задержка, мкс: p50 " << percentile(0.5) << ", p99 " << percentile(0.99) << ", p999 "
+              << percentile(0.999) << "\n";
+}
 
-                    try {
-                        if (system.checkAccess(userId, resourceName)) {
-                            std::cout << "Доступ разрешен\n";
-                        }
-                    } catch (const AccessDeniedException& e) {
-                        std::cerr << "Ошибка доступа: " << e.what() << std::endl;
-                    } catch (const std::runtime_error& e) {
-                        std::cerr << "Ошибка: " << e.what() << std::endl;
+// Пропускная способность проверок из нескольких потоков без аудита и с аудитом
+void benchmarkAudit(size_t userCount, size_t resourceCount, double seconds) {
+    if (userCount == 0 || resourceCount == 0) {
+        throw InvalidInputException("Число пользователей и ресурсов должно быть больше нуля");
+    }
+    const std::string filename = "audit_benchmark.bin";
+    unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+    AccessControlSystem<Resource> system;
+    generateSyntheticDirectory(system, userCount, resourceCount, 42);
+    std::vector<std::string> names;
+    system.forEachResource([&](const Resource& resource) { names.push_back(resource.getName()); });
+
+    auto run = [&](const std::string& label) {
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> total{0};
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::mt19937 rng(t + 1);
+                uint64_t done = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (int i = 0; i < 256; ++i) {
+                        int id = static_cast<int>(rng() % userCount) + 1;
+                        system.decideAccess(id, names[rng() % names.size()]);
                     }
-                    break;
-                }
-                case 6: {
-                    std::string name;
-                    std::cout << "Введите имя для поиска: ";
-                    std::getline(std::cin, name);
-                    system.findUserByName(name);
-                    break;
-                }
-                case 7: {
-                    int id;
-                    std::cout << "Введите ID для поиска: ";
-                    std::cin >> id;
-                    std::cin.ignore();
-                    system.findUserById(id);
-                    break;
-                }
-                case 8:
-                    system.sortUsersByAccessLevel();
-                    std::cout << "Пользователи отсортированы по уровню доступа\n";
-                    break;
-                case 9:
-                    system.sortUsersByName();
-                    std::cout << "Пользователи отсортированы по имени\n";
-                    break;
-                case 10: {
-                    std::string filename;
-                    std::cout << "Введите имя файла для сохранения: ";
-                    std::getline(std::cin, filename);
-                    system.saveToFile(filename);
-                    std::cout << "Данные сохранены в файл " << filename << std::endl;
-                    break;
-                }
-                case 11: {
-                    std::string filename;
-                    std::cout << "Введите имя файла для загрузки: ";
-                    std::getline(std::cin, filename);
-                    system.loadFromFile(filename);
-                    std::cout << "Данные загружены из файла " << filename << std::endl;
-                    break;
+                    done += 256;
                 }
-                case 0:
-                    return;
-                default:
-                    std::cout << "Неверный выбор\n";
+                total += done;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+        for (auto& worker : workers) worker.join();
+        std::cout << label << ": " << static_cast<long long>(total / seconds) << " проверок/с\n";
+    };
+
+    std::cout << "Потоков: " << threads << "\n";
+    run("Без аудита");
+    std::remove(filename.c_str());
+    system.enableAudit(filename);
+    run("С аудитом");
+    system.flushAudit();
+    AuditTrail::Stats stats = system.auditStats();
+    std::cout << "Принято записей: " << stats.recorded << ", записано: " << stats.written
+              << ", отброшено: " << stats.dropped << ", блоков: " << stats.flushes << "\n";
+    system.disableAudit();
+    std::remove(filename.c_str());
+}
+
+// Параметры набора замеров (--bench)
+struct BenchmarkConfig {
+    size_t users = 1000000;
+    size_t resources = 100000;
+    size_t samples = 200000;  // наибольшее число замеров на операцию
+    double secondsPerOperation = 2.0; // ограничение времени на операцию
+    unsigned seed = 42;
+    std::string label;        // например, хэш коммита
+    std::string jsonFile;     // пусто - JSON не пишется
+};
+
+// Не дает компилятору выбросить вычисление, результат которого в замере
+// не используется: значение считается прочитанным, а память - измененной
+template<typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+// Поток вывода, отбрасывающий все данные: операции поиска печатают результат
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+// Набор замеров основных операций на синтетическом справочнике. Для каждой
+// операции выводятся операции/с и задержки p50/p99/p999 отдельных вызовов,
+// в конце - пиковый RSS. С --json результаты пишутся в файл для сравнения
+// между коммитами.
+void runBenchmarkSuite(const BenchmarkConfig& config) {
+    using Clock = std::chrono::steady_clock;
+    const std::string textFile = "benchmark_data.txt";
+    const std::string snapshotFile = "benchmark_data.bin";
+
+    struct Result {
+        std::string name;
+        size_t samples;
+        double opsPerSecond;
+        double p50, p99, p999; // наносекунды
+    };
+    std::vector<Result> results;
+
+    // Вызывает op(i) до config.samples раз или пока не истечет время, но не меньше 3 раз
+    auto measure = [&](const std::string& name, const std::function<void(size_t)>& op) {
+        std::vector<double> latencies;
+        latencies.reserve(std::min<size_t>(config.samples, 1 << 20));
+        auto deadline = Clock::now() + std::chrono::duration<double>(config.secondsPerOperation);
+        double total = 0;
+        for (size_t i = 0; i < config.samples; ++i) {
+            auto start = Clock::now();
+            op(i);
+            auto end = Clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            latencies.push_back(ns);
+            total += ns;
+            if (i >= 2 && end >= deadline) break;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) {
+            size_t rank = static_cast<size_t>(p * latencies.size());
+            return latencies[std::min(rank, latencies.size() - 1)];
+        };
+        results.push_back({name, latencies.size(), latencies.size() / (total / 1e9),
+                           percentile(0.50), percentile(0.99), percentile(0.999)});
+        const Result& r = results.back();
+        std::printf("%-28s %10zu %14.0f %12.0f %12.0f %12.0f\n", r.name.c_str(), r.samples, r.opsPerSecond,
+                    r.p50, r.p99, r.p999);
+        std::fflush(stdout);
+    };
+
+    std::printf("Пользователей: %zu, ресурсов: %zu, seed: %u\n", config.users, config.resources, config.seed);
+    std::printf("%-28s %10s %14s %12s %12s %12s\n", "операция", "замеров", "операций/с", "p50, нс", "p99, нс",
+                "p999, нс");
+
+    AccessControlSystem<Resource> system;
+    auto start = Clock::now();
+    generateSyntheticDirectory(system, config.users, config.resources, config.seed);
+    double generation = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("Справочник построен за %.2f с\n", generation);
+
+    std::vector<std::string> resourceNames;
+    system.forEachResource([&](const Resource& resource) { resourceNames.push_back(resource.getName()); });
+    std::vector<std::string> userNames;
+    system.forEachUser([&](const User& user) {
+        if (userNames.size() < 4096) userNames.push_back(user.getName());
+    });
+
+    // Одинаковая последовательность запросов для всех операций: 1% к несуществующим ID
+    std::mt19937_64 rng(config.seed);
+    std::vector<int> ids(1 << 16);
+    std::vector<uint32_t> resourceIndexes(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ids[i] = 1 + static_cast<int>(rng() % (config.users + config.users / 100 + 1));
+        resourceIndexes[i] = static_cast<uint32_t>(rng() % std::max<size_t>(resourceNames.size(), 1));
+    }
+    const size_t mask = ids.size() - 1;
+
+    if (!resourceNames.empty()) {
+        measure("decideAccess", [&](size_t i) {
+            doNotOptimize(system.decideAccess(ids[i & mask], resourceNames[resourceIndexes[i & mask]]));
+        });
+        measure("checkAccess", [&](size_t i) {
+            try {
+                doNotOptimize(system.checkAccess(ids[i & mask], resourceNames[resourceIndexes[i & mask]]));
+            } catch (const std::exception&) {
+                // отказ - тоже результат проверки
+            }
+        });
+    }
+    measure("getUser", [&](size_t i) { doNotOptimize(system.getUser(ids[i & mask])); });
+
+    NullBuffer nullBuffer;
+    std::streambuf* console = std::cout.rdbuf(&nullBuffer);
+    try {
+        measure("findUserById", [&](size_t i) { system.findUserById(ids[i & mask]); });
+        if (!userNames.empty()) {
+            measure("findUserByName", [&](size_t i) { system.findUserByName(userNames[i % userNames.size()]); });
+        }
+    } catch (...) {
+        std::cout.rdbuf(console);
+        throw;
+    }
+    std::cout.rdbuf(console);
+    if (!userNames.empty()) {
+        measure("findUsersByWordPrefix", [&](size_t i) {
+            const std::string& name = userNames[i % userNames.size()];
+            doNotOptimize(system.findUsersByWordPrefix(name.substr(0, name.find(' ')), 10));
+        });
+    }
+
+    measure("sortUsersByName", [&](size_t) { system.sortUsersByName(); });
+    measure("sortUsersByAccessLevel", [&](size_t) { system.sortUsersByAccessLevel(); });
+    measure("saveToFile", [&](size_t) { system.saveToFile(textFile); });
+    measure("loadFromFile", [&](size_t) { system.loadFromFile(textFile); });
+    measure("saveSnapshot", [&](size_t) { system.saveSnapshot(snapshotFile); });
+    measure("loadSnapshot", [&](size_t) { system.loadSnapshot(snapshotFile); });
+    std::remove(textFile.c_str());
+    std::remove(snapshotFile.c_str());
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long peakRssKb = usage.ru_maxrss; // в Linux - килобайты
+    std::printf("Пиковый RSS: %ld КБ\n", peakRssKb);
+
+    if (!config.jsonFile.empty()) {
+        std::ofstream json(config.jsonFile);
+        if (!json) throw std::runtime_error("Не удалось открыть файл для записи результатов");
+        json.setf(std::ios::fixed);
+        json.precision(3);
+        auto quoted = [](const std::string& text) {
+            std::string out = "\"";
+            for (char c : text) {
+                if (c == '"' || c == '\\') out += '\\';
+                out += c;
+            }
+            return out + "\"";
+        };
+        json << "{\n  \"label\": " << quoted(config.label) << ",\n"
+             << "  \"users\": " << config.users << ",\n"
+             << "  \"resources\": " << config.resources << ",\n"
+             << "  \"seed\": " << config.seed << ",\n"
+             << "  \"generationSeconds\": " << generation << ",\n"
+             << "  \"peakRssKb\": " << peakRssKb << ",\n"
+             << "  \"operations\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            json << "    {\"name\": " << quoted(r.name) << ", \"samples\": " << r.samples
+                 << ", \"opsPerSecond\": " << r.opsPerSecond << ", \"p50Ns\": " << r.p50
+                 << ", \"p99Ns\": " << r.p99 << ", \"p999Ns\": " << r.p999 << "}"
+                 << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        json << "  ]\n}\n";
+        if (!json) throw std::runtime_error("Ошибка записи результатов");
+        std::printf("Результаты записаны в %s\n", config.jsonFile.c_str());
+    }
+}
+
+// Остановка сервера по SIGINT/SIGTERM
+std::atomic<bool> serverStopRequested{false};
+
+void requestServerStop(int) { serverStopRequested = true; }
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        // --bench [--users N] [--resources N] [--samples N] [--seconds S] [--seed N] [--label L] [--json FILE]
+        try {
+            BenchmarkConfig config;
+            for (int i = 2; i < argc; i += 2) {
+                std::string option = argv[i];
+                if (i + 1 >= argc) throw InvalidInputException("Не задано значение для " + option);
+                std::string value = argv[i + 1];
+                if (option == "--users") config.users = std::stoul(value);
+                else if (option == "--resources") config.resources = std::stoul(value);
+                else if (option == "--samples") config.samples = std::max(1ul, std::stoul(value));
+                else if (option == "--seconds") config.secondsPerOperation = std::stod(value);
+                else if (option == "--seed") config.seed = static_cast<unsigned>(std::stoul(value));
+                else if (option == "--label") config.label = value;
+                else if (option == "--json") config.jsonFile = value;
+                else throw InvalidInputException("Неизвестный параметр " + option);
             }
+            runBenchmarkSuite(config);
         } catch (const std::exception& e) {
             std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
         }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-batch") {
+        try {
+            size_t users = argc > 2 ? std::stoul(argv[2]) : 200000;
+            size_t resources = argc > 3 ? std::stoul(argv[3]) : 20000;
+            size_t queries = argc > 4 ? std::stoul(argv[4]) : 1000000;
+            benchmarkBatchAccess(users, resources, queries);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-journal") {
+        try {
+            size_t users = argc > 2 ? std::stoul(argv[2]) : 200000;
+            size_t changes = argc > 3 ? std::stoul(argv[3]) : 100000;
+            benchmarkJournal(users, changes);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-columnar") {
+        try {
+            benchmarkColumnarStore(argc > 2 ? std::stoul(argv[2]) : 1000000);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-audit") {
+        try {
+            size_t users = argc > 2 ? std::stoul(argv[2]) : 100000;
+            size_t resources = argc > 3 ? std::stoul(argv[3]) : 10000;
+            double seconds = argc > 4 ? std::stod(argv[4]) : 2.0;
+            benchmarkAudit(users, resources, seconds);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--decode-audit") {
+        try {
+            std::vector<std::string> names;
+            if (argc > 3) {
+                AccessControlSystem<Resource> data;
+                data.loadFromFile(argv[3]);
+                data.forEachResource([&](const Resource& resource) { names.push_back(resource.getName()); });
+            }
+            decodeAuditFile(argv[2], names, std::cout);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--serve") {
+        // --serve [--data FILE] [--snapshot FILE] [--socket PATH]: без --socket - stdin/stdout
+        try {
+            std::string dataFile, snapshotFile, socketPath;
+            for (int i = 2; i < argc; i += 2) {
+                std::string option = argv[i];
+                if (i + 1 >= argc) throw InvalidInputException("Не задано значение для " + option);
+                if (option == "--data") dataFile = argv[i + 1];
+                else if (option == "--snapshot") snapshotFile = argv[i + 1];
+                else if (option == "--socket") socketPath = argv[i + 1];
+                else throw InvalidInputException("Неизвестный параметр " + option);
+            }
+            std::signal(SIGPIPE, SIG_IGN);
+            ConcurrentAccessControlSystem<Resource> system;
+            if (!dataFile.empty() || !snapshotFile.empty()) {
+                system.update([&](AccessControlSystem<Resource>& next) {
+                    if (!snapshotFile.empty()) next.loadSnapshot(snapshotFile);
+                    else next.loadFromFile(dataFile);
+                });
+            }
+            if (socketPath.empty()) {
+                CommandServer server(system);
+                server.serve(STDIN_FILENO, STDOUT_FILENO);
+            } else {
+                std::signal(SIGINT, requestServerStop);
+                std::signal(SIGTERM, requestServerStop);
+                CommandServer::listen(system, socketPath, serverStopRequested);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-serve") {
+        try {
+            size_t users = argc > 2 ? std::stoul(argv[2]) : 100000;
+            size_t resources = argc > 3 ? std::stoul(argv[3]) : 10000;
+            unsigned connections = argc > 4 ? static_cast<unsigned>(std::stoul(argv[4])) : 4;
+            size_t requests = argc > 5 ? std::stoul(argv[5]) : 200000;
+            size_t depth = argc > 6 ? std::max(1ul, std::stoul(argv[6])) : 64;
+            benchmarkServer(users, resources, connections, requests, depth);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-roles") {
+        try {
+            size_t users = argc > 2 ? std::stoul(argv[2]) : 100000;
+            size_t resources = argc > 3 ? std::stoul(argv[3]) : 100000;
+            benchmarkRoles(users, resources);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-intern") {
+        try {
+            benchmarkInterning(argc > 2 ? std::stoul(argv[2]) : 300000);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-import") {
+        try {
+            benchmarkImport(argc > 2 ? std::stoul(argv[2]) : 200000);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-concurrent") {
+        try {
+            size_t users = argc > 2 ? std::stoul(argv[2]) : 100000;
+            size_t resources = argc > 3 ? std::stoul(argv[3]) : 10000;
+            double seconds = argc > 4 ? std::stod(argv[4]) : 2.0;
+            benchmarkConcurrentAccess(users, resources, seconds);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-bloom") {
+        try {
+            size_t users = argc > 2 ? std::stoul(argv[2]) : 200000;
+            size_t resources = argc > 3 ? std::stoul(argv[3]) : 20000;
+            size_t queries = argc > 4 ? std::stoul(argv[4]) : 1000000;
+            double probeShare = argc > 5 ? std::stod(argv[5]) : 0.5;
+            benchmarkBloomFilters(users, resources, queries, probeShare);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-disk") {
+        try {
+            size_t users = argc > 2 ? std::stoul(argv[2]) : 1000000;
+            size_t resources = argc > 3 ? std::stoul(argv[3]) : 100000;
+            size_t cacheMb = argc > 4 ? std::stoul(argv[4]) : 8;
+            size_t samples = argc > 5 ? std::max(1ul, std::stoul(argv[5])) : 2000;
+            benchmarkDiskDirectory(users, resources, cacheMb, samples);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-reload") {
+        try {
+            size_t users = argc > 2 ? std::stoul(argv[2]) : 200000;
+            size_t resources = argc > 3 ? std::stoul(argv[3]) : 20000;
+            unsigned readers = argc > 4 ? static_cast<unsigned>(std::stoul(argv[4])) : 4;
+            int reloads = argc > 5 ? std::max(1, std::stoi(argv[5])) : 5;
+            benchmarkReload(users, resources, readers, reloads);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
     }
-}
 
-int main() {
     AccessControlSystem<Resource> system;
 
     // Добавим несколько тестовых данных
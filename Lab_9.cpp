@@ -7,36 +7,891 @@
 #include <typeinfo>
 #include <ctime>
 #include <sstream>
+#include <map>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <charconv>
+#include <string_view>
+
+// Метка времени строки лога. Формат прежний, без ведущих нулей.
+// Вызывается из потоков всех писателей, поэтому localtime_r, а не localtime
+// с общим статическим буфером.
+inline void formatLogTime(time_t time, char (&stamp)[64]) {
+    tm local;
+    localtime_r(&time, &local);
+    std::snprintf(stamp, sizeof(stamp), "[%d-%d-%d %d:%d:%d] ", 1900 + local.tm_year, 1 + local.tm_mon,
+                  local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec);
+}
+
+// Уровни важности сообщений лога
+enum class LogLevel { Debug, Info, Warning, Error, Off };
+
+// Уровень, ниже которого вызовы логгера не компилируются вовсе
+// (0 - Debug, 1 - Info, 2 - Warning, 3 - Error, 4 - Off), например
+// -DLOG_COMPILED_LEVEL=1 убирает из сборки все отладочные сообщения.
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL 0
+#endif
+
+inline const char* logLevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "debug";
+        case LogLevel::Info: return "info";
+        case LogLevel::Warning: return "warning";
+        case LogLevel::Error: return "error";
+        default: return "off";
+    }
+}
+
+inline LogLevel parseLogLevel(const std::string& text) {
+    for (LogLevel level : {LogLevel::Debug, LogLevel::Info, LogLevel::Warning, LogLevel::Error, LogLevel::Off}) {
+        if (text == logLevelName(level)) return level;
+    }
+    throw std::invalid_argument("Unknown log level: " + text);
+}
+
+// Форматирование сообщения по шаблону с подстановками "{}" прямо в место
+// назначения (std::string или поток) без промежуточных строк. Числа
+// выводятся через to_chars, строки копируются как есть; прочие типы - через
+// operator<<. Лишние "{}" выводятся как есть, лишние аргументы пропускаются.
+namespace logfmt {
+    inline void append(std::string& out, const char* data, size_t size) { out.append(data, size); }
+    inline void append(std::ostream& out, const char* data, size_t size) {
+        out.write(data, static_cast<std::streamsize>(size));
+    }
+
+    template<typename Out, typename Arg>
+    void put(Out& out, const Arg& arg) {
+        if constexpr (std::is_same<Arg, bool>::value) {
+            append(out, arg ? "true" : "false", arg ? 4 : 5);
+        } else if constexpr (std::is_same<Arg, char>::value) {
+            append(out, &arg, 1);
+        } else if constexpr (std::is_arithmetic<Arg>::value) {
+            char digits[32];
+            std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), arg);
+            append(out, digits, static_cast<size_t>(result.ptr - digits));
+        } else if constexpr (std::is_convertible<const Arg&, std::string_view>::value) {
+            std::string_view text = arg;
+            append(out, text.data(), text.size());
+        } else {
+            std::ostringstream text;
+            text << arg;
+            std::string value = text.str();
+            append(out, value.data(), value.size());
+        }
+    }
+
+    template<typename Out>
+    void format(Out& out, const char* pattern) {
+        append(out, pattern, std::strlen(pattern));
+    }
+
+    template<typename Out, typename Arg, typename... Rest>
+    void format(Out& out, const char* pattern, const Arg& arg, const Rest&... rest) {
+        const char* hole = std::strstr(pattern, "{}");
+        if (!hole) {
+            format(out, pattern);
+            return;
+        }
+        append(out, pattern, static_cast<size_t>(hole - pattern));
+        put(out, arg);
+        format(out, hole + 2, rest...);
+    }
+}
+
+// Асинхронная запись лога в один файл. Сообщения попадают в ограниченную
+// очередь без блокировок (кольцо с номерами последовательности, несколько
+// производителей), фоновый поток забирает их пачками раз в flushInterval
+// (или раньше, если очередь заполнена наполовину) и пишет одним вызовом с
+// одним сбросом буфера. При заполненной очереди сообщение отбрасывается и
+// учитывается в dropped: игровая логика никогда не ждет диска.
+// Создается LogSink, по одному на файл.
+class AsyncLogWriter {
+public:
+    struct Options {
+        size_t queueCapacity = 1 << 14; // сообщений, округляется до степени двойки
+        std::chrono::milliseconds flushInterval{100}; // не меньше 1 мс
+    };
+
+    struct Stats {
+        uint64_t enqueued = 0;
+        uint64_t dropped = 0;
+        uint64_t written = 0;
+        uint64_t batches = 0;
+        size_t queueDepth = 0;
+    };
 
-// Шаблонный класс Logger для записи логов
-template<typename T>
-class Logger {
 private:
-    std::ofstream logFile;
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        time_t time = 0;
+        std::string text;
+    };
+
+    std::ofstream file;
+    Options options;
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0}; // меняет только фоновый поток
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<bool> drainRequested{false};
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable flushed;
+    uint64_t flushRequests = 0;
+    uint64_t flushesDone = 0;
+    bool stopping = false;
+    std::thread writer;
+
+    // Забирает все сообщения из очереди и пишет их одним блоком.
+    // Метка времени форматируется один раз на секунду.
+    void drain(std::string& batch) {
+        time_t formattedTime = -1;
+        char stamp[64] = "";
+        uint64_t count = 0;
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != pos + 1) break;
+            if (slot.time != formattedTime) {
+                formattedTime = slot.time;
+                formatLogTime(formattedTime, stamp);
+            }
+            batch += stamp;
+            batch += slot.text;
+            batch += '\n';
+            slot.text.clear();
+            slot.sequence.store(pos + mask + 1, std::memory_order_release);
+            dequeuePos.store(++pos, std::memory_order_relaxed);
+            ++count;
+        }
+        if (count == 0) return;
+        file.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+        file.flush();
+        batch.clear();
+        written.fetch_add(count, std::memory_order_relaxed);
+        batches.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void writeLoop() {
+        std::string batch;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wakeUp.wait_for(lock, options.flushInterval, [&] {
+                return stopping || flushRequests != flushesDone || drainRequested.load();
+            });
+            drainRequested.store(false);
+            uint64_t requested = flushRequests;
+            bool last = stopping;
+            lock.unlock();
+            drain(batch);
+            lock.lock();
+            flushesDone = requested;
+            flushed.notify_all();
+            if (last) return;
+        }
+    }
+
 public:
-    Logger(const std::string& filename) {
-        logFile.open(filename, std::ios::app);
-        if (!logFile.is_open()) {
+    AsyncLogWriter(const std::string& filename, const Options& opts) : options(opts) {
+        // С нулевым интервалом wait_for возвращается сразу и писатель крутится вхолостую
+        options.flushInterval = std::max(options.flushInterval, std::chrono::milliseconds(1));
+        size_t capacity = 2;
+        while (capacity < options.queueCapacity) capacity <<= 1;
+        options.queueCapacity = capacity;
+        mask = capacity - 1;
+        slots.reset(new Slot[capacity]);
+        for (size_t i = 0; i < capacity; ++i) slots[i].sequence.store(i, std::memory_order_relaxed);
+        file.open(filename, std::ios::app | std::ios::binary);
+        if (!file.is_open()) {
             throw std::runtime_error("Unable to open log file");
         }
+        writer = std::thread(&AsyncLogWriter::writeLoop, this);
     }
 
-    ~Logger() {
-        if (logFile.is_open()) {
-            logFile.close();
+    AsyncLogWriter(const AsyncLogWriter&) = delete;
+    AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+    // Дописывает все принятые сообщения
+    ~AsyncLogWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
         }
+        wakeUp.notify_one();
+        writer.join();
     }
 
-    void log(const T& message) {
+    // Ставит сообщение в очередь; false, если очередь заполнена и оно отброшено
+    bool enqueue(std::string message) {
+        return enqueueWith([&](std::string& text) { text = std::move(message); });
+    }
+
+    // То же, но текст пишет fill(std::string&) прямо в строку слота: ее
+    // память остается от прошлых сообщений, поэтому выделений обычно нет
+    template<typename Fill>
+    bool enqueueWith(Fill&& fill) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[pos & mask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            if (sequence == pos) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (sequence < pos) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->time = time(0);
+        try {
+            fill(slot->text);
+        } catch (...) {
+            slot->text.clear(); // слот все равно нужно отдать писателю
+            slot->sequence.store(pos + 1, std::memory_order_release);
+            throw;
+        }
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        // Будим писателя заранее; потерянное уведомление заменит таймер
+        if (pos - dequeuePos.load(std::memory_order_relaxed) == mask / 2 && !drainRequested.exchange(true)) {
+            wakeUp.notify_one();
+        }
+        return true;
+    }
+
+    // Ждет, пока все сообщения, принятые до вызова, окажутся в файле
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t target = ++flushRequests;
+        wakeUp.notify_one();
+        flushed.wait(lock, [&] { return flushesDone >= target; });
+    }
+
+    Stats getStats() const {
+        Stats stats;
+        size_t tail = dequeuePos.load(std::memory_order_relaxed);
+        size_t head = enqueuePos.load(std::memory_order_relaxed);
+        stats.dropped = dropped.load(std::memory_order_relaxed);
+        stats.enqueued = head;
+        stats.written = written.load(std::memory_order_relaxed);
+        stats.batches = batches.load(std::memory_order_relaxed);
+        stats.queueDepth = head > tail ? head - tail : 0;
+        return stats;
+    }
+};
+
+// Место назначения лога. На каждый файл в процессе есть ровно один приемник
+// с одним буферизованным дескриптором (forFile); логгеры только ссылаются на
+// него, поэтому создание монстра не открывает файлов. Синхронный режим пишет
+// в буфер потока под мьютексом и сбрасывает его при заполнении и в flush;
+// асинхронный (enableAsync) передает сообщения AsyncLogWriter. Приемники
+// живут до завершения программы и при выходе дописывают все сообщения.
+class LogSink {
+private:
+    static constexpr size_t bufferSize = 1 << 16;
+
+    std::string filename;
+    std::mutex mutex;
+    std::unique_ptr<char[]> buffer; // буфер синхронного режима
+    std::ofstream file;
+    std::unique_ptr<AsyncLogWriter> async;
+    time_t formattedTime = -1;
+    char stamp[64] = "";
+
+    struct Registry {
+        std::mutex mutex;
+        std::map<std::string, std::unique_ptr<LogSink>> sinks;
+        bool async = false;
+        AsyncLogWriter::Options options;
+        std::atomic<LogLevel> level{LogLevel::Debug}; // читается без мьютекса
+    };
+
+    static Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    void openSync() {
+        if (!buffer) buffer.reset(new char[bufferSize]);
+        file.rdbuf()->pubsetbuf(buffer.get(), bufferSize); // до open
+        file.open(filename, std::ios::app | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Unable to open log file");
+        }
+    }
+
+    // Переключение режима; вызывается под мьютексом реестра
+    void setMode(bool asyncMode, const AsyncLogWriter::Options& options) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (asyncMode) {
+            if (file.is_open()) file.close();
+            async = std::make_unique<AsyncLogWriter>(filename, options);
+        } else {
+            async.reset(); // дописывает очередь
+            if (!file.is_open()) openSync();
+        }
+    }
+
+public:
+    LogSink(const std::string& name, bool asyncMode, const AsyncLogWriter::Options& options) : filename(name) {
+        if (asyncMode) async = std::make_unique<AsyncLogWriter>(filename, options);
+        else openSync();
+    }
+
+    LogSink(const LogSink&) = delete;
+    LogSink& operator=(const LogSink&) = delete;
+
+    void write(std::string message) {
+        if (async) {
+            async->enqueue(std::move(message));
+            return;
+        }
+        time_t now = time(0);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (now != formattedTime) {
+            formattedTime = now;
+            formatLogTime(now, stamp);
+        }
+        file << stamp << message << '\n';
+    }
+
+    // Форматирует сообщение сразу в буфер файла или в строку слота очереди
+    template<typename... Args>
+    void writeFormatted(const char* pattern, const Args&... args) {
+        if (async) {
+            async->enqueueWith([&](std::string& text) { logfmt::format(text, pattern, args...); });
+            return;
+        }
         time_t now = time(0);
-        tm* ltm = localtime(&now);
-        logFile << "[" << 1900 + ltm->tm_year << "-" 
-                << 1 + ltm->tm_mon << "-" << ltm->tm_mday << " "
-                << ltm->tm_hour << ":" << ltm->tm_min << ":" << ltm->tm_sec << "] "
-                << message << std::endl;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (now != formattedTime) {
+            formattedTime = now;
+            formatLogTime(now, stamp);
+        }
+        file << stamp;
+        logfmt::format(file, pattern, args...);
+        file << '\n';
+    }
+
+    void flush() {
+        if (async) {
+            async->flush();
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        file.flush();
+    }
+
+    const std::string& getFilename() const { return filename; }
+
+    // Общий приемник для файла; открывает файл только при первом обращении.
+    // Приемники не удаляются до выхода, поэтому поток запоминает найденные
+    // и не берет мьютекс реестра при создании каждого логгера.
+    static LogSink& forFile(const std::string& filename) {
+        thread_local std::unordered_map<std::string, LogSink*> known;
+        auto found = known.find(filename);
+        if (found != known.end()) return *found->second;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::unique_ptr<LogSink>& sink = r.sinks[filename];
+        if (!sink) sink = std::make_unique<LogSink>(filename, r.async, r.options);
+        known.emplace(filename, sink.get());
+        return *sink;
+    }
+
+    // Переводит все приемники, существующие и будущие, в асинхронный режим.
+    // Вызывать, пока другие потоки не пишут в лог.
+    static void enableAsync(const AsyncLogWriter::Options& options) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.async = true;
+        r.options = options;
+        for (auto& entry : r.sinks) entry.second->setMode(true, options);
+    }
+
+    static void enableAsync() { enableAsync(AsyncLogWriter::Options()); }
+
+    // Возвращает синхронный режим, дописав очереди
+    static void disableAsync() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.async = false;
+        for (auto& entry : r.sinks) entry.second->setMode(false, r.options);
+    }
+
+    // Уровень, начиная с которого сообщения пишутся (для всех приемников)
+    static void setLevel(LogLevel level) { registry().level.store(level, std::memory_order_relaxed); }
+    static LogLevel getLevel() { return registry().level.load(std::memory_order_relaxed); }
+    static bool enabled(LogLevel level) { return level >= getLevel(); }
+
+    static bool isAsync() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        return r.async;
+    }
+
+    // Дожидается записи всех сообщений во все файлы
+    static void flushAll() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (auto& entry : r.sinks) entry.second->flush();
+    }
+
+    static size_t count() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        return r.sinks.size();
+    }
+
+    // Сумма по асинхронным писателям (queueDepth - суммарная глубина очередей)
+    static AsyncLogWriter::Stats asyncStats() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        AsyncLogWriter::Stats total;
+        for (const auto& entry : r.sinks) {
+            if (!entry.second->async) continue;
+            AsyncLogWriter::Stats stats = entry.second->async->getStats();
+            total.enqueued += stats.enqueued;
+            total.dropped += stats.dropped;
+            total.written += stats.written;
+            total.batches += stats.batches;
+            total.queueDepth += stats.queueDepth;
+        }
+        return total;
+    }
+};
+
+// Шаблонный класс Logger для записи логов.
+// Логгер - легкая ссылка на общий для файла LogSink: его можно создавать
+// и копировать без файлового ввода-вывода.
+// Сообщения уровней ниже MinLevel не компилируются; остальные отсекаются
+// уровнем LogSink::setLevel до форматирования. debug/info/warning/error
+// принимают шаблон с "{}" и аргументы и форматируют их прямо в приемник.
+template<typename T, LogLevel MinLevel = static_cast<LogLevel>(LOG_COMPILED_LEVEL)>
+class Logger {
+private:
+    LogSink* sink;
+
+    static std::string toText(const T& message) {
+        if constexpr (std::is_convertible<T, std::string>::value) {
+            return message;
+        } else {
+            std::ostringstream out;
+            out << message;
+            return out.str();
+        }
+    }
+
+public:
+    Logger(const std::string& filename) : sink(&LogSink::forFile(filename)) {}
+
+    static constexpr bool compiledIn(LogLevel level) { return level >= MinLevel && level != LogLevel::Off; }
+
+    // Готовое сообщение уровня Info
+    void log(const T& message) {
+        if constexpr (compiledIn(LogLevel::Info)) {
+            if (LogSink::enabled(LogLevel::Info)) sink->write(toText(message));
+        }
+    }
+
+    template<LogLevel Level, typename... Args>
+    void logAt(const char* pattern, const Args&... args) {
+        if constexpr (compiledIn(Level)) {
+            if (LogSink::enabled(Level)) sink->writeFormatted(pattern, args...);
+        }
     }
+
+    template<typename... Args>
+    void debug(const char* pattern, const Args&... args) { logAt<LogLevel::Debug>(pattern, args...); }
+
+    template<typename... Args>
+    void info(const char* pattern, const Args&... args) { logAt<LogLevel::Info>(pattern, args...); }
+
+    template<typename... Args>
+    void warning(const char* pattern, const Args&... args) { logAt<LogLevel::Warning>(pattern, args...); }
+
+    template<typename... Args>
+    void error(const char* pattern, const Args&... args) { logAt<LogLevel::Error>(pattern, args...); }
 };
 
+// Двоичный структурированный лог событий игры. Каждое событие - запись
+// фиксированного для своего типа вида: номер события (1 байт), время в
+// наносекундах от открытия лога по монотонным часам (8 байт) и поля
+// события: имена как номера в таблице строк (4 байта), числа как int32.
+// Строка попадает в файл один раз - записью StringDef перед первым
+// событием, которое на нее ссылается. Числа пишутся в little-endian.
+// Заголовок файла: "RPGBLOG1" и время открытия (наносекунды Unix).
+// Включается open (один файл на процесс) и работает вместе с текстовыми
+// логгерами; чтобы писать только его, выключите их уровнем Off.
+class BinaryLog {
+public:
+    enum Event : uint8_t {
+        StringDef, Attack, DamageTaken, Heal, LevelUp, ItemAdded, ItemRemoved, BattleStart, BattleEnd, EventCount
+    };
+
+    enum Outcome { Won, Fled, Lost };
+
+    // Событие после расшифровки; неиспользуемые поля пусты
+    struct Record {
+        Event event = StringDef;
+        uint64_t time = 0;
+        std::string subject;
+        std::string object;
+        int32_t value = 0;
+        int32_t total = 0;
+    };
+
+    struct Stats {
+        uint64_t events = 0;
+        uint64_t strings = 0;
+        uint64_t bytes = 0;
+    };
+
+    static constexpr char magic[9] = "RPGBLOG1";
+
+private:
+    enum Field : uint8_t { None, Subject, Object, Value, Total };
+
+    // Состав записи и текст при расшифровке: %s, %o, %v, %t - поля,
+    // %r - значение как исход боя
+    struct Schema {
+        const char* name;
+        const char* text;
+        Field fields[3];
+    };
+
+    static const Schema& schema(Event event) {
+        static const Schema schemas[EventCount] = {
+            {"string", "", {None, None, None}},
+            {"attack", "%s attacks %o for %v damage!", {Subject, Object, Value}},
+            {"damage_taken", "%s takes %v damage. Remaining HP: %t", {Subject, Value, Total}},
+            {"heal", "%s heals for %v HP. Current HP: %t", {Subject, Value, Total}},
+            {"level_up", "%s leveled up to level %v!", {Subject, Value, None}},
+            {"item_added", "Added item: %o (slot %v)", {Object, Value, None}},
+            {"item_removed", "Removed item: %o (slot %v)", {Object, Value, None}},
+            {"battle_start", "Battle started between %s and %o", {Subject, Object, None}},
+            {"battle_end", "Battle between %s and %o ended: %r", {Subject, Object, Value}},
+        };
+        return schemas[event];
+    }
+
+    static constexpr size_t bufferSize = 1 << 16;
+
+    std::mutex mutex;
+    std::ofstream file;
+    std::string buffer;
+    std::unordered_map<std::string, uint32_t> strings;
+    std::chrono::steady_clock::time_point start;
+    Stats stats;
+
+    static std::atomic<BinaryLog*>& current() {
+        static std::atomic<BinaryLog*> log{nullptr};
+        return log;
+    }
+
+    static std::unique_ptr<BinaryLog>& owner() {
+        static std::unique_ptr<BinaryLog> log;
+        return log;
+    }
+
+    void putU16(uint16_t value) {
+        buffer += static_cast<char>(value & 0xFF);
+        buffer += static_cast<char>(value >> 8);
+    }
+
+    void putU32(uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) buffer += static_cast<char>((value >> shift) & 0xFF);
+    }
+
+    void putU64(uint64_t value) {
+        for (int shift = 0; shift < 64; shift += 8) buffer += static_cast<char>((value >> shift) & 0xFF);
+    }
+
+    // Номер строки; новая строка сначала записывается в таблицу
+    uint32_t intern(const std::string& text) {
+        auto found = strings.find(text);
+        if (found != strings.end()) return found->second;
+        uint32_t id = static_cast<uint32_t>(strings.size());
+        size_t length = std::min<size_t>(text.size(), 0xFFFF);
+        strings.emplace(text, id);
+        buffer += static_cast<char>(StringDef);
+        putU32(id);
+        putU16(static_cast<uint16_t>(length));
+        buffer.append(text, 0, length);
+        ++stats.strings;
+        return id;
+    }
+
+    void write(Event event, const std::string* subject, const std::string* object, int32_t value, int32_t total) {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count(); // под мьютексом: время в файле не убывает
+        const Schema& layout = schema(event);
+        uint32_t ids[2] = {subject ? intern(*subject) : 0, object ? intern(*object) : 0};
+        buffer += static_cast<char>(event);
+        putU64(time);
+        for (Field field : layout.fields) {
+            switch (field) {
+                case Subject: putU32(ids[0]); break;
+                case Object: putU32(ids[1]); break;
+                case Value: putU32(static_cast<uint32_t>(value)); break;
+                case Total: putU32(static_cast<uint32_t>(total)); break;
+                case None: break;
+            }
+        }
+        ++stats.events;
+        if (buffer.size() >= bufferSize) writeBuffer();
+    }
+
+    void writeBuffer() {
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        stats.bytes += buffer.size();
+        buffer.clear();
+    }
+
+    static void record(Event event, const std::string* subject, const std::string* object,
+                       int32_t value = 0, int32_t total = 0) {
+        BinaryLog* log = current().load(std::memory_order_acquire);
+        if (log) log->write(event, subject, object, value, total);
+    }
+
+public:
+    explicit BinaryLog(const std::string& filename) : start(std::chrono::steady_clock::now()) {
+        file.open(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Unable to open log file");
+        }
+        buffer.reserve(bufferSize + 256);
+        buffer.append(magic, 8);
+        putU64(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()));
+    }
+
+    BinaryLog(const BinaryLog&) = delete;
+    BinaryLog& operator=(const BinaryLog&) = delete;
+
+    ~BinaryLog() {
+        writeBuffer();
+    }
+
+    // Начинает новый файл лога (прежний закрывается). Вызывать, пока
+    // другие потоки не пишут события.
+    static void open(const std::string& filename) {
+        close();
+        owner() = std::make_unique<BinaryLog>(filename);
+        current().store(owner().get(), std::memory_order_release);
+    }
+
+    static void close() {
+        current().store(nullptr, std::memory_order_release);
+        owner().reset();
+    }
+
+    static bool isOpen() { return current().load(std::memory_order_acquire) != nullptr; }
+
+    static void flush() {
+        BinaryLog* log = current().load(std::memory_order_acquire);
+        if (!log) return;
+        std::lock_guard<std::mutex> lock(log->mutex);
+        log->writeBuffer();
+        log->file.flush();
+    }
+
+    // Байты считаются по уже записанному в файл (после flush - все)
+    static Stats getStats() {
+        BinaryLog* log = current().load(std::memory_order_acquire);
+        if (!log) return Stats();
+        std::lock_guard<std::mutex> lock(log->mutex);
+        return log->stats;
+    }
+
+    static void attack(const std::string& attacker, const std::string& target, int damage) {
+        record(Attack, &attacker, &target, damage);
+    }
+
+    static void damageTaken(const std::string& name, int damage, int health) {
+        record(DamageTaken, &name, nullptr, damage, health);
+    }
+
+    static void heal(const std::string& name, int amount, int health) {
+        record(Heal, &name, nullptr, amount, health);
+    }
+
+    static void levelUp(const std::string& name, int level) { record(LevelUp, &name, nullptr, level); }
+
+    static void itemAdded(const std::string& item, int slot) { record(ItemAdded, nullptr, &item, slot); }
+
+    static void itemRemoved(const std::string& item, int slot) { record(ItemRemoved, nullptr, &item, slot); }
+
+    static void battleStart(const std::string& player, const std::string& monster) {
+        record(BattleStart, &player, &monster);
+    }
+
+    static void battleEnd(const std::string& player, const std::string& monster, Outcome outcome) {
+        record(BattleEnd, &player, &monster, outcome);
+    }
+
+    static const char* eventName(Event event) { return event < EventCount ? schema(event).name : "unknown"; }
+
+    static const char* outcomeName(int32_t outcome) {
+        switch (outcome) {
+            case Won: return "won";
+            case Fled: return "fled";
+            case Lost: return "lost";
+            default: return "unknown";
+        }
+    }
+
+    // Последовательное чтение файла двоичного лога
+    class Reader {
+    private:
+        std::ifstream in;
+        std::vector<std::string> strings;
+        uint64_t openedAt = 0; // наносекунды Unix
+
+        bool readBytes(char* data, size_t size) {
+            in.read(data, static_cast<std::streamsize>(size));
+            return static_cast<size_t>(in.gcount()) == size;
+        }
+
+        uint64_t readUnsigned(int bytes) {
+            unsigned char data[8];
+            if (!readBytes(reinterpret_cast<char*>(data), bytes)) {
+                throw std::runtime_error("Truncated binary log");
+            }
+            uint64_t value = 0;
+            for (int i = bytes - 1; i >= 0; --i) value = (value << 8) | data[i];
+            return value;
+        }
+
+        const std::string& lookup(uint32_t id) const {
+            if (id >= strings.size()) throw std::runtime_error("Binary log refers to unknown string");
+            return strings[id];
+        }
+
+    public:
+        explicit Reader(const std::string& filename) : in(filename, std::ios::binary) {
+            if (!in.is_open()) {
+                throw std::runtime_error("Unable to open log file");
+            }
+            char header[8];
+            if (!readBytes(header, 8) || std::memcmp(header, magic, 8) != 0) {
+                throw std::runtime_error("Not a binary game log");
+            }
+            openedAt = readUnsigned(8);
+        }
+
+        uint64_t getOpenedAt() const { return openedAt; }
+
+        // Следующее событие; false в конце файла
+        bool next(Record& record) {
+            while (true) {
+                char type;
+                if (!readBytes(&type, 1)) return false;
+                Event event = static_cast<Event>(static_cast<unsigned char>(type));
+                if (event == StringDef) {
+                    uint32_t id = static_cast<uint32_t>(readUnsigned(4));
+                    size_t length = static_cast<size_t>(readUnsigned(2));
+                    std::string text(length, '\0');
+                    if (!readBytes(&text[0], length)) throw std::runtime_error("Truncated binary log");
+                    if (id != strings.size()) throw std::runtime_error("Binary log string table is out of order");
+                    strings.push_back(std::move(text));
+                    continue;
+                }
+                if (event >= EventCount) throw std::runtime_error("Unknown event in binary log");
+                record = Record();
+                record.event = event;
+                record.time = readUnsigned(8);
+                for (Field field : schema(event).fields) {
+                    switch (field) {
+                        case Subject: record.subject = lookup(static_cast<uint32_t>(readUnsigned(4))); break;
+                        case Object: record.object = lookup(static_cast<uint32_t>(readUnsigned(4))); break;
+                        case Value: record.value = static_cast<int32_t>(readUnsigned(4)); break;
+                        case Total: record.total = static_cast<int32_t>(readUnsigned(4)); break;
+                        case None: break;
+                    }
+                }
+                return true;
+            }
+        }
+    };
+
+    // Текст события в том же виде, что и в текстовых логах
+    static std::string describe(const Record& record) {
+        std::string text;
+        for (const char* p = schema(record.event).text; *p; ++p) {
+            if (*p != '%' || !p[1]) {
+                text += *p;
+                continue;
+            }
+            switch (*++p) {
+                case 's': text += record.subject; break;
+                case 'o': text += record.object; break;
+                case 'v': text += std::to_string(record.value); break;
+                case 't': text += std::to_string(record.total); break;
+                case 'r': text += outcomeName(record.value); break;
+                default: text += '%'; text += *p;
+            }
+        }
+        return text;
+    }
+
+    // Переводит двоичный лог в текст ("[время] сообщение") или CSV
+    // (time_ns,event,subject,object,value,total); возвращает число событий
+    static uint64_t decode(const std::string& filename, std::ostream& out, bool csv) {
+        Reader reader(filename);
+        Record record;
+        uint64_t count = 0;
+        auto quote = [](const std::string& text) {
+            std::string quoted = "\"";
+            for (char c : text) {
+                if (c == '"') quoted += '"';
+                quoted += c;
+            }
+            return quoted + "\"";
+        };
+        if (csv) out << "time_ns,event,subject,object,value,total\n";
+        while (reader.next(record)) {
+            if (csv) {
+                out << record.time << ',' << eventName(record.event) << ',' << quote(record.subject) << ','
+                    << quote(record.object) << ',' << record.value << ',' << record.total << '\n';
+            } else {
+                uint64_t at = reader.getOpenedAt() + record.time;
+                time_t seconds = static_cast<time_t>(at / 1000000000);
+                char stamp[32];
+                tm local;
+                localtime_r(&seconds, &local);
+                std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+                char fraction[16];
+                std::snprintf(fraction, sizeof(fraction), ".%06u", static_cast<unsigned>(at % 1000000000 / 1000));
+                out << '[' << stamp << fraction << "] " << describe(record) << '\n';
+            }
+            ++count;
+        }
+        return count;
+    }
+};
+
+// Куда правила боя печатают сообщения о ходе боя. Свой для каждого потока:
+// безголовая симуляция выключает вывод (nullptr) в рабочих потоках.
+inline std::ostream*& combatOutput() {
+    thread_local std::ostream* out = &std::cout;
+    return out;
+}
+
 // Класс предмета в инвентаре
 class Item {
 protected:
@@ -51,7 +906,7 @@ public:
         return name + ": " + description;
     }
 
-    std::string getName() const { return name; }
+    const std::string& getName() const { return name; }
 };
 
 // Оружие
@@ -92,12 +947,14 @@ public:
 
     void addItem(std::unique_ptr<Item> item) {
         items.push_back(std::move(item));
-        logger.log("Added item: " + items.back()->getName());
+        logger.info("Added item: {}", items.back()->getName());
+        BinaryLog::itemAdded(items.back()->getName(), static_cast<int>(items.size()) - 1);
     }
 
     void removeItem(int index) {
         if (index >= 0 && index < items.size()) {
-            logger.log("Removed item: " + items[index]->getName());
+            logger.info("Removed item: {}", items[index]->getName());
+            BinaryLog::itemRemoved(items[index]->getName(), index);
             items.erase(items.begin() + index);
         }
     }
@@ -123,6 +980,10 @@ public:
     }
 
     size_t size() const { return items.size(); }
+
+    Item* getItem(int index) const {
+        return index >= 0 && index < static_cast<int>(items.size()) ? items[index].get() : nullptr;
+    }
 };
 
 // Базовый класс монстра
@@ -141,9 +1002,10 @@ public:
     virtual void attackTarget(class Character& target);
     virtual void takeDamage(int damage) {
         health -= damage;
-        logger.log(name + " takes " + std::to_string(damage) + " damage. Remaining HP: " + std::to_string(health));
+        logger.debug("{} takes {} damage. Remaining HP: {}", name, damage, health);
+        BinaryLog::damageTaken(name, damage, health);
         if (health <= 0) {
-            logger.log(name + " has been defeated!");
+            logger.info("{} has been defeated!", name);
         }
     }
 
@@ -154,7 +1016,7 @@ public:
                ", DEF: " + std::to_string(defense) + ")";
     }
 
-    std::string getName() const { return name; }
+    const std::string& getName() const { return name; }
     int getHealth() const { return health; }
     int getAttack() const { return attack; }
     int getDefense() const { return defense; }
@@ -181,7 +1043,7 @@ public:
         if (!isResurrected && health - damage <= 0) {
             health = 30; // Воскрешение с 30 HP
             isResurrected = true;
-            logger.log(name + " has resurrected with 30 HP!");
+            logger.info("{} has resurrected with 30 HP!", name);
         } else {
             Monster::takeDamage(damage);
         }
@@ -204,48 +1066,57 @@ private:
     int experience;
     Inventory inventory;
     Logger<std::string> logger;
+    bool throwOnDefeat = true;
 public:
     Character(const std::string& n, int h, int a, int d) 
         : name(n), health(h), maxHealth(h), attack(a), defense(d), 
           level(1), experience(0), logger("character_log.txt") {
-        logger.log("Character " + name + " created");
+        logger.info("Character {} created", name);
     }
 
     void attackEnemy(Monster& enemy) {
         int damage = attack - enemy.getDefense();
         if (damage > 0) {
             enemy.takeDamage(damage);
-            logger.log(name + " attacks " + enemy.getName() + " for " + std::to_string(damage) + " damage!");
-            std::cout << name << " attacks " << enemy.getName() << " for " << damage << " damage!" << std::endl;
+            logger.debug("{} attacks {} for {} damage!", name, enemy.getName(), damage);
+            BinaryLog::attack(name, enemy.getName(), damage);
+            if (std::ostream* out = combatOutput()) {
+                *out << name << " attacks " << enemy.getName() << " for " << damage << " damage!" << std::endl;
+            }
             
             if (!enemy.isAlive()) {
                 gainExperience(30);
             }
         } else {
-            logger.log(name + " attacks " + enemy.getName() + ", but it has no effect!");
-            std::cout << name << " attacks " << enemy.getName() << ", but it has no effect!" << std::endl;
+            logger.debug("{} attacks {}, but it has no effect!", name, enemy.getName());
+            BinaryLog::attack(name, enemy.getName(), 0);
+            if (std::ostream* out = combatOutput()) {
+                *out << name << " attacks " << enemy.getName() << ", but it has no effect!" << std::endl;
+            }
         }
     }
 
     void takeDamage(int damage) {
         health -= damage;
-        logger.log(name + " takes " + std::to_string(damage) + " damage. Remaining HP: " + std::to_string(health));
+        logger.debug("{} takes {} damage. Remaining HP: {}", name, damage, health);
+        BinaryLog::damageTaken(name, damage, health);
         if (health <= 0) {
-            logger.log(name + " has been defeated!");
-            throw std::runtime_error(name + " has been defeated!");
+            logger.info("{} has been defeated!", name);
+            if (throwOnDefeat) throw std::runtime_error(name + " has been defeated!");
         }
     }
 
     void heal(int amount) {
         health += amount;
         if (health > maxHealth) health = maxHealth;
-        logger.log(name + " heals for " + std::to_string(amount) + " HP. Current HP: " + std::to_string(health));
-        std::cout << name << " heals for " << amount << " HP!" << std::endl;
+        logger.info("{} heals for {} HP. Current HP: {}", name, amount, health);
+        BinaryLog::heal(name, amount, health);
+        if (std::ostream* out = combatOutput()) *out << name << " heals for " << amount << " HP!" << std::endl;
     }
 
     void gainExperience(int exp) {
         experience += exp;
-        logger.log(name + " gains " + std::to_string(exp) + " experience. Total: " + std::to_string(experience));
+        logger.debug("{} gains {} experience. Total: {}", name, exp, experience);
         if (experience >= 100) {
             levelUp();
         }
@@ -258,9 +1129,12 @@ public:
         health = maxHealth;
         attack += 5;
         defense += 3;
-        logger.log(name + " leveled up to level " + std::to_string(level) + "!");
-        std::cout << name << " leveled up to level " << level << "!" << std::endl;
-        std::cout << "Stats improved: HP +20, ATK +5, DEF +3" << std::endl;
+        logger.info("{} leveled up to level {}!", name, level);
+        BinaryLog::levelUp(name, level);
+        if (std::ostream* out = combatOutput()) {
+            *out << name << " leveled up to level " << level << "!" << std::endl;
+            *out << "Stats improved: HP +20, ATK +5, DEF +3" << std::endl;
+        }
     }
 
     void displayInfo() const {
@@ -283,6 +1157,13 @@ public:
         inventory.display();
     }
 
+    const Inventory& getInventory() const { return inventory; }
+
+    // Без исключения поражение видно только по здоровью. Так работает
+    // безголовая симуляция: исключение на каждый проигранный бой дороже
+    // самого боя.
+    void setThrowOnDefeat(bool value) { throwOnDefeat = value; }
+
     void saveGame(const std::string& filename) {
         std::ofstream out(filename);
         if (!out) {
@@ -293,7 +1174,7 @@ public:
             << attack << "\n" << defense << "\n" 
             << level << "\n" << experience << "\n";
         
-        logger.log("Game saved for character " + name);
+        logger.info("Game saved for character {}", name);
     }
 
     void loadGame(const std::string& filename) {
@@ -304,10 +1185,10 @@ public:
         
         in >> name >> health >> maxHealth >> attack >> defense >> level >> experience;
         
-        logger.log("Game loaded for character " + name);
+        logger.info("Game loaded for character {}", name);
     }
 
-    std::string getName() const { return name; }
+    const std::string& getName() const { return name; }
     int getHealth() const { return health; }
     int getMaxHealth() const { return maxHealth; }
     int getAttack() const { return attack; }
@@ -319,13 +1200,14 @@ public:
 // Реализация методов использования предметов
 void Weapon::use(Character& character) {
     // В этой реализации оружие не расходуется
-    std::cout << name << " is already equipped and being used!" << std::endl;
+    if (std::ostream* out = combatOutput()) *out << name << " is already equipped and being used!" << std::endl;
 }
 
 void HealthPotion::use(Character& character) {
     character.heal(healAmount);
-    std::cout << character.getName() << " used " << name << " and healed " 
-              << healAmount << " HP!" << std::endl;
+    if (std::ostream* out = combatOutput()) {
+        *out << character.getName() << " used " << name << " and healed " << healAmount << " HP!" << std::endl;
+    }
 }
 
 // Реализация метода атаки монстра
@@ -333,14 +1215,74 @@ void Monster::attackTarget(Character& target) {
     int damage = attack - target.getDefense();
     if (damage > 0) {
         target.takeDamage(damage);
-        logger.log(name + " attacks " + target.getName() + " for " + std::to_string(damage) + " damage!");
-        std::cout << name << " attacks " << target.getName() << " for " << damage << " damage!" << std::endl;
+        logger.debug("{} attacks {} for {} damage!", name, target.getName(), damage);
+        BinaryLog::attack(name, target.getName(), damage);
+        if (std::ostream* out = combatOutput()) {
+            *out << name << " attacks " << target.getName() << " for " << damage << " damage!" << std::endl;
+        }
     } else {
-        logger.log(name + " attacks " + target.getName() + ", but it has no effect!");
-        std::cout << name << " attacks " << target.getName() << ", but it has no effect!" << std::endl;
+        logger.debug("{} attacks {}, but it has no effect!", name, target.getName());
+        BinaryLog::attack(name, target.getName(), 0);
+        if (std::ostream* out = combatOutput()) {
+            *out << name << " attacks " << target.getName() << ", but it has no effect!" << std::endl;
+        }
     }
 }
 
+// Правила хода боя, общие для Game::battle и безголовой симуляции
+// (BattleSimulator). Урон за ход накапливается в Turn; если персонаж
+// погибает, исключение из Character::takeDamage уходит вызывающему, а
+// полученный урон к этому моменту уже учтен.
+class BattleRules {
+public:
+    struct Turn {
+        bool fled = false;
+        int damageDealt = 0;
+        int damageTaken = 0;
+    };
+
+    // Ответный удар монстра
+    static void monsterTurn(Character& player, Monster& monster, Turn& turn) {
+        int before = player.getHealth();
+        try {
+            monster.attackTarget(player);
+        } catch (...) {
+            turn.damageTaken += before - player.getHealth();
+            throw;
+        }
+        turn.damageTaken += before - player.getHealth();
+    }
+
+    static void attack(Character& player, Monster& monster, Turn& turn) {
+        // Учитывается урон, который монстр действительно потерял: без
+        // избыточного урона и без удара, после которого скелет воскрес
+        int before = monster.getHealth();
+        player.attackEnemy(monster);
+        turn.damageDealt += std::max(0, before - std::max(0, monster.getHealth()));
+        if (monster.isAlive()) {
+            monsterTurn(player, monster, turn);
+        }
+    }
+
+    // index - номер предмета в инвентаре с нуля
+    static void useItem(Character& player, Monster& monster, int index, Turn& turn) {
+        player.useItem(index);
+        monsterTurn(player, monster, turn);
+    }
+
+    // Бегство удается с шансом 50%: random() должен вернуть четное число
+    template<typename Random>
+    static void flee(Character& player, Monster& monster, Random&& random, Turn& turn) {
+        if (random() % 2 == 0) {
+            if (std::ostream* out = combatOutput()) *out << "You successfully fled from battle!\n";
+            turn.fled = true;
+        } else {
+            if (std::ostream* out = combatOutput()) *out << "You failed to flee!\n";
+            monsterTurn(player, monster, turn);
+        }
+    }
+};
+
 // Класс игры
 class Game {
 private:
@@ -348,7 +1290,7 @@ private:
     Logger<std::string> logger;
 public:
     Game() : logger("game_log.txt") {
-        logger.log("Game started");
+        logger.info("Game started");
     }
 
     void start() {
@@ -363,7 +1305,7 @@ public:
         player->addToInventory(std::make_unique<Weapon>("Iron Sword", "A basic iron sword", 10));
         player->addToInventory(std::make_unique<HealthPotion>("Small Health Potion", "Restores 30 HP", 30));
         
-        logger.log("New game started with character " + name);
+        logger.info("New game started with character {}", name);
         
         mainMenu();
     }
@@ -390,7 +1332,7 @@ public:
                     case 3: 
                         player->showInventory(); 
                         if (player->getHealth() < player->getMaxHealth() && 
-                            dynamic_cast<HealthPotion*>(&(*player->getInventory().getItem(0)))) {
+                            dynamic_cast<HealthPotion*>(player->getInventory().getItem(0))) {
                             std::cout << "Would you like to use a health potion? (y/n): ";
                             char use;
                             std::cin >> use;
@@ -412,6 +1354,7 @@ public:
                 }
             } catch (const std::exception& e) {
                 std::cerr << "Error: " << e.what() << "\n";
+                logger.error("Error: {}", e.what());
                 if (player->getHealth() <= 0) {
                     std::cout << "Game Over!\n";
                     return;
@@ -440,7 +1383,8 @@ public:
     }
 
     void battle(Monster& monster) {
-        logger.log("Battle started between " + player->getName() + " and " + monster.getName());
+        logger.info("Battle started between {} and {}", player->getName(), monster.getName());
+        BinaryLog::battleStart(player->getName(), monster.getName());
         
         while (player->getHealth() > 0 && monster.isAlive()) {
             std::cout << "\n=== Battle ===\n";
@@ -457,12 +1401,10 @@ public:
             std::cin.ignore();
             
             try {
+                BattleRules::Turn turn;
                 switch (choice) {
                     case 1:
-                        player->attackEnemy(monster);
-                        if (monster.isAlive()) {
-                            monster.attackTarget(*player);
-                        }
+                        BattleRules::attack(*player, monster, turn);
                         break;
                     case 2:
                         player->showInventory();
@@ -472,21 +1414,18 @@ public:
                             std::cin >> itemChoice;
                             std::cin.ignore();
                             if (itemChoice > 0 && itemChoice <= player->getInventory().size()) {
-                                player->useItem(itemChoice - 1);
-                                monster.attackTarget(*player);
+                                BattleRules::useItem(*player, monster, itemChoice - 1, turn);
                             }
                         } else {
                             std::cout << "Inventory is empty!\n";
                         }
                         break;
                     case 3:
-                        if (rand() % 2 == 0) { // 50% шанс убежать
-                            std::cout << "You successfully fled from battle!\n";
-                            logger.log(player->getName() + " fled from battle");
+                        BattleRules::flee(*player, monster, [] { return rand(); }, turn);
+                        if (turn.fled) {
+                            logger.info("{} fled from battle", player->getName());
+                            BinaryLog::battleEnd(player->getName(), monster.getName(), BinaryLog::Fled);
                             return;
-                        } else {
-                            std::cout << "You failed to flee!\n";
-                            monster.attackTarget(*player);
                         }
                         break;
                     default:
@@ -494,8 +1433,10 @@ public:
                 }
             } catch (const std::exception& e) {
                 std::cerr << "Error: " << e.what() << "\n";
+                logger.error("Error: {}", e.what());
                 if (player->getHealth() <= 0) {
                     std::cout << "Game Over!\n";
+                    BinaryLog::battleEnd(player->getName(), monster.getName(), BinaryLog::Lost);
                     return;
                 }
             }
@@ -503,14 +1444,521 @@ public:
         
         if (player->getHealth() > 0) {
             std::cout << "You defeated the " << monster.getName() << "!\n";
-            logger.log(player->getName() + " defeated " + monster.getName());
+            logger.info("{} defeated {}", player->getName(), monster.getName());
+            BinaryLog::battleEnd(player->getName(), monster.getName(), BinaryLog::Won);
+        }
+    }
+};
+
+// Стратегия игрока для безголовой симуляции: выбирает действие на каждом
+// ходу вместо ввода с клавиатуры. Вызывается из нескольких потоков, поэтому
+// choose не должен менять состояние стратегии.
+class BattlePolicy {
+public:
+    enum Action { Attack, UseItem, Flee };
+
+    virtual ~BattlePolicy() {}
+
+    // Для UseItem в itemIndex записывается номер предмета с нуля
+    virtual Action choose(const Character& player, const Monster& monster, int& itemIndex) const = 0;
+    virtual const char* getName() const = 0;
+
+    // attack, potion или cautious
+    static std::unique_ptr<BattlePolicy> create(const std::string& name);
+
+protected:
+    // Номер первого зелья в инвентаре или -1
+    static int findPotion(const Character& player) {
+        const Inventory& inventory = player.getInventory();
+        for (int i = 0; i < static_cast<int>(inventory.size()); ++i) {
+            if (dynamic_cast<HealthPotion*>(inventory.getItem(i))) return i;
         }
+        return -1;
+    }
+
+    static bool isLow(const Character& player, double threshold) {
+        return player.getHealth() < player.getMaxHealth() * threshold;
     }
 };
 
-int main() {
+// Всегда атакует
+class AggressivePolicy : public BattlePolicy {
+public:
+    Action choose(const Character&, const Monster&, int&) const override { return Attack; }
+    const char* getName() const override { return "attack"; }
+};
+
+// Пьет зелье, когда здоровья меньше порога, иначе атакует
+class PotionPolicy : public BattlePolicy {
+private:
+    double threshold;
+public:
+    explicit PotionPolicy(double t = 0.4) : threshold(t) {}
+
+    Action choose(const Character& player, const Monster&, int& itemIndex) const override {
+        if (isLow(player, threshold)) {
+            itemIndex = findPotion(player);
+            if (itemIndex >= 0) return UseItem;
+        }
+        return Attack;
+    }
+
+    const char* getName() const override { return "potion"; }
+};
+
+// Как PotionPolicy, но без зелий при низком здоровье убегает, а от
+// монстра, которого не может ранить, убегает сразу
+class CautiousPolicy : public BattlePolicy {
+private:
+    double threshold;
+public:
+    explicit CautiousPolicy(double t = 0.4) : threshold(t) {}
+
+    Action choose(const Character& player, const Monster& monster, int& itemIndex) const override {
+        if (player.getAttack() <= monster.getDefense()) return Flee;
+        if (isLow(player, threshold)) {
+            itemIndex = findPotion(player);
+            return itemIndex >= 0 ? UseItem : Flee;
+        }
+        return Attack;
+    }
+
+    const char* getName() const override { return "cautious"; }
+};
+
+std::unique_ptr<BattlePolicy> BattlePolicy::create(const std::string& name) {
+    if (name == "attack") return std::make_unique<AggressivePolicy>();
+    if (name == "potion") return std::make_unique<PotionPolicy>();
+    if (name == "cautious") return std::make_unique<CautiousPolicy>();
+    throw std::invalid_argument("Unknown policy: " + name);
+}
+
+// Безголовая симуляция боев для подбора характеристик. Каждый прогон -
+// новый персонаж (с зельями, как в начале игры), который проводит до
+// battlesPerRun боев со случайными монстрами по правилам BattleRules, пока
+// не погибнет. Случайность прогона задается только seed и его номером,
+// поэтому итог не зависит от числа потоков. Прогоны делятся между потоками
+// порциями; на время симуляции текстовые логи выключены, а рабочие потоки
+// ничего не печатают.
+class BattleSimulator {
+public:
+    struct Options {
+        uint64_t runs = 1000000;
+        int battlesPerRun = 1;
+        uint64_t seed = 1;
+        unsigned threads = 0; // 0 - по числу ядер
+        int health = 100;
+        int attack = 15;
+        int defense = 10;
+        int potions = 1;
+        int turnLimit = 1000;   // бой без исхода за столько ходов считается ничьей
+        int histogramStep = 10; // ширина корзины гистограмм урона
+    };
+
+    static constexpr int monsterTypes = 3;
+    static constexpr int histogramBuckets = 16; // последняя - все, что больше
+
+    struct MonsterStats {
+        uint64_t battles = 0;
+        uint64_t won = 0;
+        uint64_t fled = 0;
+        uint64_t lost = 0;
+        uint64_t stalled = 0;
+        uint64_t turns = 0;
+        int maxTurns = 0;
+        uint64_t damageDealt = 0;
+        uint64_t damageTaken = 0;
+        uint64_t dealtHistogram[histogramBuckets] = {};
+        uint64_t takenHistogram[histogramBuckets] = {};
+
+        void merge(const MonsterStats& other) {
+            battles += other.battles;
+            won += other.won;
+            fled += other.fled;
+            lost += other.lost;
+            stalled += other.stalled;
+            turns += other.turns;
+            maxTurns = std::max(maxTurns, other.maxTurns);
+            damageDealt += other.damageDealt;
+            damageTaken += other.damageTaken;
+            for (int i = 0; i < histogramBuckets; ++i) {
+                dealtHistogram[i] += other.dealtHistogram[i];
+                takenHistogram[i] += other.takenHistogram[i];
+            }
+        }
+    };
+
+    struct Result {
+        MonsterStats monsters[monsterTypes];
+        uint64_t runs = 0;
+        uint64_t survivors = 0; // дожили до конца прогона
+        unsigned threads = 0;
+        double seconds = 0;
+
+        void merge(const Result& other) {
+            for (int i = 0; i < monsterTypes; ++i) monsters[i].merge(other.monsters[i]);
+            runs += other.runs;
+            survivors += other.survivors;
+        }
+    };
+
+private:
+    static constexpr uint64_t chunk = 1024;
+
+    // splitmix64: свой поток чисел для каждого прогона
+    class Random {
+    private:
+        uint64_t state;
+    public:
+        Random(uint64_t seed, uint64_t run) : state(seed ^ (run * 0x9E3779B97F4A7C15ull)) { next(); }
+
+        uint64_t next() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        uint64_t operator()() { return next(); }
+    };
+
+    static std::unique_ptr<Monster> createMonster(int type) {
+        switch (type) {
+            case 0: return std::make_unique<Goblin>();
+            case 1: return std::make_unique<Dragon>();
+            default: return std::make_unique<Skeleton>();
+        }
+    }
+
+    static int bucket(int damage, int step) {
+        return std::min(histogramBuckets - 1, std::max(0, damage) / step);
+    }
+
+    static void simulateRun(uint64_t run, const BattlePolicy& policy, const Options& options, Result& result) {
+        Random random(options.seed, run);
+        Character player("Simulated", options.health, options.attack, options.defense);
+        player.setThrowOnDefeat(false);
+        for (int i = 0; i < options.potions; ++i) {
+            player.addToInventory(std::make_unique<HealthPotion>("Small Health Potion", "Restores 30 HP", 30));
+        }
+        for (int battle = 0; battle < options.battlesPerRun; ++battle) {
+            int type = static_cast<int>(random() % monsterTypes);
+            std::unique_ptr<Monster> monster = createMonster(type);
+            MonsterStats& stats = result.monsters[type];
+            BattleRules::Turn turn;
+            int turns = 0;
+            while (player.getHealth() > 0 && monster->isAlive() && turns < options.turnLimit) {
+                ++turns;
+                int itemIndex = -1;
+                switch (policy.choose(player, *monster, itemIndex)) {
+                    case BattlePolicy::Attack: BattleRules::attack(player, *monster, turn); break;
+                    case BattlePolicy::UseItem: BattleRules::useItem(player, *monster, itemIndex, turn); break;
+                    case BattlePolicy::Flee: BattleRules::flee(player, *monster, random, turn); break;
+                }
+                if (turn.fled) break;
+            }
+            ++stats.battles;
+            stats.turns += turns;
+            stats.maxTurns = std::max(stats.maxTurns, turns);
+            stats.damageDealt += turn.damageDealt;
+            stats.damageTaken += turn.damageTaken;
+            ++stats.dealtHistogram[bucket(turn.damageDealt, options.histogramStep)];
+            ++stats.takenHistogram[bucket(turn.damageTaken, options.histogramStep)];
+            if (player.getHealth() <= 0) {
+                ++stats.lost;
+                break;
+            }
+            if (turn.fled) ++stats.fled;
+            else if (monster->isAlive()) ++stats.stalled;
+            else ++stats.won;
+        }
+        ++result.runs;
+        if (player.getHealth() > 0) ++result.survivors;
+    }
+
+public:
+    static const char* monsterName(int type) {
+        static const char* const names[monsterTypes] = {"Goblin", "Dragon", "Skeleton"};
+        return names[type];
+    }
+
+    static Result run(const BattlePolicy& policy, const Options& options) {
+        if (options.runs == 0 || options.battlesPerRun < 1 || options.histogramStep < 1) {
+            throw std::invalid_argument("Invalid simulation options");
+        }
+        unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<uint64_t>(threads, (options.runs + chunk - 1) / chunk));
+        LogLevel level = LogSink::getLevel();
+        LogSink::setLevel(LogLevel::Off);
+        auto start = std::chrono::steady_clock::now();
+
+        std::atomic<uint64_t> nextRun{0};
+        std::vector<Result> partial(threads);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                combatOutput() = nullptr;
+                while (true) {
+                    uint64_t first = nextRun.fetch_add(chunk, std::memory_order_relaxed);
+                    if (first >= options.runs) break;
+                    uint64_t last = std::min(options.runs, first + chunk);
+                    for (uint64_t run = first; run < last; ++run) simulateRun(run, policy, options, partial[t]);
+                }
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+
+        Result result;
+        for (const Result& part : partial) result.merge(part);
+        result.threads = threads;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LogSink::setLevel(level);
+        return result;
+    }
+
+    static void print(const Result& result, const Options& options, const BattlePolicy& policy, std::ostream& out) {
+        auto percent = [](uint64_t part, uint64_t total) { return total ? 100.0 * part / total : 0.0; };
+        out << "Policy: " << policy.getName() << ", runs: " << result.runs << ", battles per run: "
+            << options.battlesPerRun << ", seed: " << options.seed << "\n";
+        out << "Character: HP " << options.health << ", ATK " << options.attack << ", DEF " << options.defense
+            << ", potions " << options.potions << "; survived runs: " << percent(result.survivors, result.runs) << "%\n";
+        uint64_t battles = 0;
+        for (const MonsterStats& stats : result.monsters) battles += stats.battles;
+        out << "Battles: " << battles << " in " << result.seconds << " s on " << result.threads << " threads ("
+            << battles / std::max(result.seconds, 1e-9) << " battles/s)\n";
+        for (int type = 0; type < monsterTypes; ++type) {
+            const MonsterStats& stats = result.monsters[type];
+            if (stats.battles == 0) continue;
+            double count = static_cast<double>(stats.battles);
+            out << "\n" << monsterName(type) << ": " << stats.battles << " battles, won "
+                << percent(stats.won, stats.battles) << "%, fled " << percent(stats.fled, stats.battles)
+                << "%, lost " << percent(stats.lost, stats.battles) << "%";
+            if (stats.stalled) out << ", stalled " << percent(stats.stalled, stats.battles) << "%";
+            out << "\n  turns: avg " << stats.turns / count << ", max " << stats.maxTurns
+                << "; damage per battle: dealt " << stats.damageDealt / count << ", taken "
+                << stats.damageTaken / count << "\n";
+            auto histogram = [&](const char* title, const uint64_t (&buckets)[histogramBuckets]) {
+                out << "  " << title << " (% of battles, step " << options.histogramStep << "):";
+                int used = histogramBuckets;
+                while (used > 1 && buckets[used - 1] == 0) --used;
+                for (int i = 0; i < used; ++i) {
+                    out << " " << i * options.histogramStep << (i == histogramBuckets - 1 ? "+" : "") << ":"
+                        << percent(buckets[i], stats.battles);
+                }
+                out << "\n";
+            };
+            histogram("dealt", stats.dealtHistogram);
+            histogram("taken", stats.takenHistogram);
+        }
+    }
+};
+
+// Поток вывода, отбрасывающий все данные (для замеров без вывода на консоль)
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+// Бои без участия игрока: персонаж бьет монстров, пока они не погибнут.
+// Возвращает время в секундах.
+double runBenchBattles(int battles) {
+    auto start = std::chrono::steady_clock::now();
+    Character hero("Bench", 1000000, 40, 12);
+    for (int i = 0; i < battles; ++i) {
+        std::unique_ptr<Monster> monster;
+        switch (i % 3) {
+            case 0: monster = std::make_unique<Goblin>(); break;
+            case 1: monster = std::make_unique<Dragon>(); break;
+            default: monster = std::make_unique<Skeleton>(); break;
+        }
+        BinaryLog::battleStart(hero.getName(), monster->getName());
+        while (monster->isAlive()) {
+            hero.attackEnemy(*monster);
+            if (monster->isAlive()) monster->attackTarget(hero);
+        }
+        BinaryLog::battleEnd(hero.getName(), monster->getName(), BinaryLog::Won);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Сравнивается синхронный и асинхронный режим логгера, затем измеряется
+// создание монстров (без файлового ввода-вывода) и число открытых приемников.
+void benchmarkLogging(int battles) {
+    NullBuffer nullBuffer;
+    std::streambuf* console = std::cout.rdbuf(&nullBuffer);
+    auto spawnStart = std::chrono::steady_clock::now();
+    const int spawns = 1000000;
+    for (int i = 0; i < spawns; ++i) {
+        Goblin goblin;
+    }
+    double spawn = std::chrono::duration<double>(std::chrono::steady_clock::now() - spawnStart).count();
+    auto run = [&] {
+        double seconds = runBenchBattles(battles);
+        LogSink::flushAll();
+        return seconds;
+    };
+    double sync = run();
+    LogSink::enableAsync();
+    double async = run();
+    AsyncLogWriter::Stats stats = LogSink::asyncStats();
+    LogSink::disableAsync();
+    LogLevel level = LogSink::getLevel();
+    LogSink::setLevel(LogLevel::Warning);
+    double filtered = run();
+
+    // Отключенное сообщение: готовая строка против шаблона с аргументами
+    Logger<std::string> logger("character_log.txt");
+    const std::string name = "Bench", enemy = "Goblin";
+    const int calls = 1000000;
+    auto eagerStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        logger.log(name + " attacks " + enemy + " for " + std::to_string(i) + " damage!");
+    }
+    double eager = std::chrono::duration<double>(std::chrono::steady_clock::now() - eagerStart).count();
+    auto lazyStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        logger.debug("{} attacks {} for {} damage!", name, enemy, i);
+    }
+    double lazy = std::chrono::duration<double>(std::chrono::steady_clock::now() - lazyStart).count();
+    LogSink::setLevel(level);
+    std::cout.rdbuf(console);
+    std::cout << "Spawned " << spawns << " goblins in " << spawn << " s, open log sinks: " << LogSink::count() << "\n";
+    std::cout << "Battles: " << battles << "\n";
+    std::cout << "Synchronous logger: " << sync << " s\n";
+    std::cout << "Asynchronous logger: " << async << " s, messages: " << stats.enqueued
+              << ", written: " << stats.written << ", batches: " << stats.batches
+              << ", dropped: " << stats.dropped << "\n";
+    std::cout << "Runtime level warning: " << filtered << " s (compiled level: "
+              << logLevelName(static_cast<LogLevel>(LOG_COMPILED_LEVEL)) << ")\n";
+    std::cout << "Disabled message, " << calls << " calls: prebuilt string " << eager
+              << " s, format arguments " << lazy << " s\n";
+}
+
+// Те же бои с текстовыми логами и с двоичным: размер на событие, скорость
+// записи и скорость расшифровки в CSV.
+void benchmarkBinaryLog(int battles) {
+    const char* textFiles[] = {"character_log.txt", "monster_log.txt", "inventory_log.txt"};
+    auto textBytes = [&] {
+        uintmax_t total = 0;
+        for (const char* name : textFiles) {
+            std::error_code error;
+            uintmax_t size = std::filesystem::file_size(name, error);
+            if (!error) total += size;
+        }
+        return total;
+    };
+    NullBuffer nullBuffer;
+    std::streambuf* console = std::cout.rdbuf(&nullBuffer);
+    LogLevel level = LogSink::getLevel();
+
+    LogSink::setLevel(LogLevel::Debug);
+    LogSink::flushAll();
+    uintmax_t textBefore = textBytes();
+    double text = runBenchBattles(battles);
+    LogSink::flushAll();
+    uintmax_t textWritten = textBytes() - textBefore;
+
+    const std::string binaryFile = "bench_log.bin";
+    LogSink::setLevel(LogLevel::Off);
+    BinaryLog::open(binaryFile);
+    double binary = runBenchBattles(battles);
+    auto flushStart = std::chrono::steady_clock::now();
+    BinaryLog::flush();
+    binary += std::chrono::duration<double>(std::chrono::steady_clock::now() - flushStart).count();
+    BinaryLog::Stats stats = BinaryLog::getStats();
+    BinaryLog::close();
+    LogSink::setLevel(level);
+
+    std::ostream discard(&nullBuffer);
+    auto decodeStart = std::chrono::steady_clock::now();
+    uint64_t decoded = BinaryLog::decode(binaryFile, discard, true);
+    double decode = std::chrono::duration<double>(std::chrono::steady_clock::now() - decodeStart).count();
+    std::cout.rdbuf(console);
+
+    double events = static_cast<double>(std::max<uint64_t>(stats.events, 1));
+    std::cout << "Battles: " << battles << ", events: " << stats.events << ", strings: " << stats.strings << "\n";
+    std::cout << "Text logs: " << textWritten << " bytes (" << textWritten / events << " per binary event), "
+              << text << " s\n";
+    std::cout << "Binary log: " << stats.bytes << " bytes (" << stats.bytes / events << " per event), "
+              << binary << " s, " << events / binary << " events/s, "
+              << stats.bytes / binary / (1 << 20) << " MB/s\n";
+    std::cout << "Decoded to CSV: " << decoded << " events in " << decode << " s\n";
+}
+
+int main(int argc, char* argv[]) {
     srand(time(0)); // Инициализация генератора случайных чисел
-    
+
+    // --log-level debug|info|warning|error|off можно указать перед режимом
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.size() > 1 && args[0] == "--log-level") {
+        try {
+            LogSink::setLevel(parseLogLevel(args[1]));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        args.erase(args.begin(), args.begin() + 2);
+    }
+
+    if (!args.empty() && args[0] == "--bench-log") {
+        benchmarkLogging(args.size() > 1 ? std::stoi(args[1]) : 20000);
+        return 0;
+    }
+    // --simulate прогоны [стратегия [seed [боев за прогон [потоки]]]]
+    if (!args.empty() && args[0] == "--simulate") {
+        try {
+            BattleSimulator::Options options;
+            if (args.size() > 1) options.runs = std::stoull(args[1]);
+            std::unique_ptr<BattlePolicy> policy = BattlePolicy::create(args.size() > 2 ? args[2] : "potion");
+            if (args.size() > 3) options.seed = std::stoull(args[3]);
+            if (args.size() > 4) options.battlesPerRun = std::stoi(args[4]);
+            if (args.size() > 5) options.threads = static_cast<unsigned>(std::stoul(args[5]));
+            BattleSimulator::Result result = BattleSimulator::run(*policy, options);
+            BattleSimulator::print(result, options, *policy, std::cout);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    if (!args.empty() && args[0] == "--bench-binlog") {
+        benchmarkBinaryLog(args.size() > 1 ? std::stoi(args[1]) : 20000);
+        return 0;
+    }
+    // --decode-log файл [text|csv]: расшифровка двоичного лога в stdout
+    if (!args.empty() && args[0] == "--decode-log") {
+        try {
+            if (args.size() < 2) throw std::invalid_argument("Usage: --decode-log file [text|csv]");
+            BinaryLog::decode(args[1], std::cout, args.size() > 2 && args[2] == "csv");
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    // --binary-log файл: события боя дополнительно пишутся в двоичный лог
+    if (args.size() > 1 && args[0] == "--binary-log") {
+        BinaryLog::open(args[1]);
+        args.erase(args.begin(), args.begin() + 2);
+    }
+    // --async-log [интервал записи, мс]: лог пишется фоновым потоком
+    bool asyncLog = !args.empty() && args[0] == "--async-log";
+    if (asyncLog) {
+        try {
+            AsyncLogWriter::Options options;
+            if (args.size() > 1) {
+                int interval = std::stoi(args[1]);
+                if (interval < 1) throw std::invalid_argument("Flush interval must be at least 1 ms");
+                options.flushInterval = std::chrono::milliseconds(interval);
+            }
+            LogSink::enableAsync(options);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
     try {
         Game game;
         game.start();
@@ -518,6 +1966,12 @@ int main() {
         std::cerr << "Fatal error: " << e.what() << "\n";
         return 1;
     }
-    
-    return 0;
+
+    if (asyncLog) {
+        LogSink::flushAll();
+        AsyncLogWriter::Stats stats = LogSink::asyncStats();
+        std::cout << "Log messages written: " << stats.written << ", dropped: " << stats.dropped << "\n";
+    }
+    BinaryLog::close();
+    return 0; // приемники дописывают логи при завершении
 }
\ No newline at end of file